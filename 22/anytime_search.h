@@ -0,0 +1,224 @@
+#ifndef ANYTIME_SEARCH_H
+#define ANYTIME_SEARCH_H
+
+// Anytime search: weighted A* with a falling weight, reusing its work (ARA*)
+// Each iteration orders the open list by g + w * h, which finds a solution quickly but
+// possibly up to w times too long. States whose g improves after they were expanded in
+// the current iteration wait on an "inconsistent" list, and rejoin the open list when
+// the next iteration starts with a smaller weight, so nothing is searched twice for
+// the same g. No state is worth reaching at g + h at or above the best solution so far.
+//
+// Some state on every optimal path is waiting, on one list or the other, at its optimal
+// g - so with an admissible heuristic the smallest g + h waiting is a lower bound on
+// the optimal length. At weight 1 improved states are reopened at once, as plain A*
+// does, so a completed iteration there is optimal even if the heuristic is
+// inconsistent. The search stops when the lower bound meets the best solution, or when
+// the time runs out.
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <vector>
+
+#include <boost/graph/graph_traits.hpp>
+
+#include "arena.h"
+#include "search.h"
+#include "stats.h"
+
+template<typename Vertex>
+struct anytime_result_t : search_result_t<Vertex> {
+    size_t upper_bound = std::numeric_limits<size_t>::max();   // the path's length, if found
+    size_t lower_bound = 0;                                     // on the optimal length
+    double weight      = 1.0;                                   // of the last iteration
+    bool   timed_out   = false;
+};
+
+// Search from "start", lowering the weight from "weight" to 1 by "weight_step" each
+// iteration, for at most "budget". Whenever a shorter solution turns up, calls
+// report(result) with the path and bounds so far.
+template<typename Graph, typename Heuristic, typename Report>
+anytime_result_t<typename boost::graph_traits<Graph>::vertex_descriptor>
+anytime_solve(Graph const& g,
+              typename boost::graph_traits<Graph>::vertex_descriptor const& start,
+              Heuristic h,
+              double weight, double weight_step,
+              std::chrono::steady_clock::duration budget,
+              Report report) {
+    using vertex_t = typename boost::graph_traits<Graph>::vertex_descriptor;
+    using clock = std::chrono::steady_clock;
+
+    // heuristics report unsolvable states as at least this far from the goal
+    constexpr size_t dead_end = std::numeric_limits<int>::max() / 2;
+    constexpr size_t unbounded = std::numeric_limits<size_t>::max();
+
+    struct vertex_record_t {
+        size_t                                              distance;
+        size_t                                              h;
+        bool                                                waiting;   // open or inconsistent
+        size_t                                              closed_in; // iteration, from 1
+        std::pair<vertex_t const, vertex_record_t> const *  predecessor;   // map entry
+    };
+    using records_t = arena_unordered_map_t<vertex_t, vertex_record_t>;
+    using node_t    = typename records_t::value_type;
+
+    // lowest g + w * h first, breaking ties toward the deepest state
+    struct open_entry_t {
+        double   key;
+        size_t   distance;
+        node_t * node;
+    };
+    auto order = [](open_entry_t const& a, open_entry_t const& b) {
+        return (a.key > b.key) || ((a.key == b.key) && (a.distance < b.distance));
+    };
+
+    auto const deadline = clock::now() + budget;
+    anytime_result_t<vertex_t> result;
+    result.weight = std::max(weight, 1.0);
+    result.iterations = 1;
+
+    records_t                   records;
+    std::vector<open_entry_t>   open;            // a heap, with stale entries
+    std::vector<node_t *>       inconsistent;
+    std::vector<size_t>         waiting_at_f;    // waiting states, counted by g + h
+    size_t                      min_f = unbounded;
+    size_t                      iteration = 1;
+    node_t const *              best = nullptr;
+
+    auto key = [&result](vertex_record_t const& rec) {
+        return static_cast<double>(rec.distance) + result.weight * static_cast<double>(rec.h);
+    };
+    auto push = [&](node_t * node) {
+        open.push_back(open_entry_t{key(node->second), node->second.distance, node});
+        std::push_heap(open.begin(), open.end(), order);
+    };
+    auto wait = [&](node_t * node) {
+        vertex_record_t & rec = node->second;
+        size_t f = rec.distance + rec.h;
+        if (waiting_at_f.size() <= f) {
+            waiting_at_f.resize(f + 1);
+        }
+        ++waiting_at_f[f];
+        min_f = std::min(min_f, f);
+        rec.waiting = true;
+        if ((rec.closed_in == iteration) && (result.weight > 1.0)) {
+            inconsistent.push_back(node);
+        } else {
+            push(node);
+        }
+    };
+    auto stop_waiting = [&](vertex_record_t & rec) {
+        --waiting_at_f[rec.distance + rec.h];
+        rec.waiting = false;
+    };
+    auto lower_bound = [&]() {
+        while ((min_f < waiting_at_f.size()) && (waiting_at_f[min_f] == 0)) {
+            ++min_f;
+        }
+        if (min_f >= waiting_at_f.size()) {
+            min_f = unbounded;
+        }
+        return std::min(min_f, result.upper_bound);
+    };
+    auto found = [&](node_t const * goal) {
+        best = goal;
+        result.upper_bound = goal->second.distance;
+        result.path.clear();
+        for (node_t const * n = goal; n; n = n->second.predecessor) {
+            result.path.push_back(n->first);
+        }
+        std::reverse(result.path.begin(), result.path.end());
+        result.lower_bound = lower_bound();
+        report(static_cast<anytime_result_t<vertex_t> const&>(result));
+    };
+
+    size_t start_h = static_cast<size_t>(h(start));
+    if (start_h >= dead_end) {
+        return result;
+    }
+    wait(&*records.emplace(start, vertex_record_t{0, start_h, false, 0, nullptr}).first);
+
+    for (;;) {
+        // improve on the best solution at this weight
+        while (!open.empty()) {
+            open_entry_t e = open.front();
+            vertex_record_t & rec = e.node->second;
+            if (!rec.waiting || (rec.distance != e.distance)) {
+                std::pop_heap(open.begin(), open.end(), order);
+                open.pop_back();
+                continue;
+            }
+            if ((best && (e.key >= static_cast<double>(result.upper_bound))) ||
+                (lower_bound() >= result.upper_bound)) {
+                break;
+            }
+            if (((result.examined & 0xff) == 0) && (clock::now() >= deadline)) {
+                result.timed_out = true;
+                break;
+            }
+            std::pop_heap(open.begin(), open.end(), order);
+            open.pop_back();
+            stop_waiting(rec);
+            rec.closed_in = iteration;
+            ++result.examined;
+            D22_COUNT(examined);
+            if (at_goal(g, e.node->first)) {
+                if (rec.distance < result.upper_bound) {
+                    found(e.node);
+                }
+                continue;
+            }
+            size_t distance = rec.distance + 1;
+            auto edges = out_edges(e.node->first, g);
+            for (auto ei = edges.first; ei != edges.second; ++ei) {
+                vertex_t succ = target(*ei, g);
+                auto it = records.find(succ);
+                if (it == records.end()) {
+                    size_t succ_h = static_cast<size_t>(h(succ));
+                    if ((succ_h >= dead_end) || (distance + succ_h >= result.upper_bound)) {
+                        continue;
+                    }
+                    it = records.emplace(std::move(succ),
+                                         vertex_record_t{distance, succ_h, false, 0,
+                                                         e.node}).first;
+                } else if ((distance < it->second.distance) &&
+                           (distance + it->second.h < result.upper_bound)) {
+                    if (it->second.waiting) {
+                        stop_waiting(it->second);
+                    }
+                    it->second.distance = distance;
+                    it->second.predecessor = e.node;
+                } else {
+                    continue;
+                }
+                wait(&*it);
+            }
+            D22_PEAK(open_peak, open.size() + inconsistent.size());
+            D22_PROGRESS(result.examined, open.size() + inconsistent.size(), min_f);
+        }
+
+        result.lower_bound = lower_bound();
+        if (result.timed_out || (result.lower_bound >= result.upper_bound) ||
+            (result.weight == 1.0)) {
+            break;
+        }
+
+        // next iteration: a smaller weight, with every waiting state open again
+        result.weight = std::max(1.0, result.weight - weight_step);
+        ++result.iterations;
+        ++iteration;
+        open.clear();
+        inconsistent.clear();
+        for (auto & r : records) {
+            if (r.second.waiting) {
+                push(&r);
+            }
+        }
+    }
+    if (!best) {
+        result.upper_bound = unbounded;
+    }
+    return result;
+}
+
+#endif // ANYTIME_SEARCH_H
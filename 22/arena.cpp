@@ -0,0 +1,98 @@
+// Search-scoped arena allocation for Advent of Code, Day 22
+
+#include "arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+
+thread_local search_arena_t * installed_arena = nullptr;
+
+}
+
+search_arena_t::search_arena_t(size_t block_bytes)
+    : block_bytes_(block_bytes), current_(0), next_(0), allocations_(0), bytes_used_(0) {}
+
+search_arena_t::~search_arena_t() {
+    flush_stats();
+}
+
+bool
+search_arena_t::fits(size_t bytes, size_t align) {
+    if (current_ >= blocks_.size()) {
+        return false;
+    }
+    block_t const & b = blocks_[current_];
+    auto base = reinterpret_cast<std::uintptr_t>(b.data.get());
+    size_t start = ((base + next_ + align - 1) & ~(std::uintptr_t(align) - 1)) - base;
+    if (start + bytes > b.size) {
+        return false;
+    }
+    next_ = start;
+    return true;
+}
+
+void *
+search_arena_t::allocate(size_t bytes, size_t align) {
+    // move on through the blocks kept from earlier searches, then get a new one
+    while (!fits(bytes, align)) {
+        if ((current_ < blocks_.size()) && (++current_ < blocks_.size())) {
+            next_ = 0;
+            continue;
+        }
+        size_t size = std::max(block_bytes_, bytes + align);
+        blocks_.push_back(block_t{std::unique_ptr<char[]>(new char[size]), size});
+        D22_COUNT(heap_allocations);
+        current_ = blocks_.size() - 1;
+        next_ = 0;
+    }
+    void * p = blocks_[current_].data.get() + next_;
+    bytes_used_ += bytes;
+    next_ += bytes;
+    ++allocations_;
+    return p;
+}
+
+void
+search_arena_t::reset() {
+    flush_stats();
+    current_ = 0;
+    next_ = 0;
+    bytes_used_ = 0;
+}
+
+size_t
+search_arena_t::allocations() const {
+    return allocations_;
+}
+
+size_t
+search_arena_t::bytes_used() const {
+    return bytes_used_;
+}
+
+size_t
+search_arena_t::blocks() const {
+    return blocks_.size();
+}
+
+// counted here rather than per allocation, which would cost an atomic add each
+void
+search_arena_t::flush_stats() {
+    D22_COUNT_N(arena_allocations, allocations_);
+    allocations_ = 0;
+}
+
+search_arena_t *
+current_arena() {
+    return installed_arena;
+}
+
+arena_scope_t::arena_scope_t(search_arena_t * arena) : previous_(installed_arena) {
+    installed_arena = arena;
+}
+
+arena_scope_t::~arena_scope_t() {
+    installed_arena = previous_;
+}
@@ -0,0 +1,123 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+// Search-scoped memory
+// A search allocates a great many small blocks - state payloads and the nodes of its
+// per-vertex record maps - and frees them all together when it finishes. An arena
+// hands them out from large blocks by bumping a pointer, ignores individual frees, and
+// reclaims everything at once with reset(), keeping its blocks for the next search.
+//
+// The Boost.Graph interfaces give no way to pass an allocator to successor generation,
+// so the arena in use is installed per thread by an arena_scope_t; arena_allocator_t
+// picks it up when constructed, and falls back on the heap when none is installed.
+// Everything allocated from an arena must be destroyed before it is reset.
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+#include "stats.h"
+
+struct search_arena_t {
+    explicit search_arena_t(size_t block_bytes = size_t(1) << 20);
+    ~search_arena_t();
+
+    search_arena_t(search_arena_t const&) = delete;
+    search_arena_t& operator=(search_arena_t const&) = delete;
+
+    void * allocate(size_t bytes, size_t align);
+
+    // free everything at once, keeping the blocks for reuse
+    void   reset();
+
+    size_t allocations() const;   // served since the last reset
+    size_t bytes_used()  const;   // ... and their total size
+    size_t blocks()      const;   // obtained from the heap, ever
+
+private:
+    struct block_t {
+        std::unique_ptr<char[]> data;
+        size_t                  size;
+    };
+
+    bool   fits(size_t bytes, size_t align);   // in the current block; aligns next_ if so
+    void   flush_stats();
+
+    size_t               block_bytes_;
+    std::vector<block_t> blocks_;
+    size_t               current_;     // block being carved up
+    size_t               next_;        // its first free byte
+    size_t               allocations_;
+    size_t               bytes_used_;
+};
+
+// the arena installed for this thread, or nullptr
+search_arena_t * current_arena();
+
+// Install an arena for this thread for as long as this object lives
+// A null arena sends allocations back to the heap.
+struct arena_scope_t {
+    explicit arena_scope_t(search_arena_t * arena);
+    ~arena_scope_t();
+
+    arena_scope_t(arena_scope_t const&) = delete;
+    arena_scope_t& operator=(arena_scope_t const&) = delete;
+
+private:
+    search_arena_t * previous_;
+};
+
+// Standard allocator drawing on an arena - by default the current one
+template<typename T>
+struct arena_allocator_t {
+    using value_type = T;
+
+    // containers move their allocator along with their contents
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap            = std::true_type;
+
+    arena_allocator_t() noexcept : arena_(current_arena()) {}
+    explicit arena_allocator_t(search_arena_t * arena) noexcept : arena_(arena) {}
+    template<typename U>
+    arena_allocator_t(arena_allocator_t<U> const& other) noexcept : arena_(other.arena()) {}
+
+    T * allocate(size_t n) {
+        if (arena_) {
+            return static_cast<T *>(arena_->allocate(n * sizeof(T), alignof(T)));
+        }
+        D22_COUNT(heap_allocations);
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T * p, size_t) noexcept {
+        if (!arena_) {
+            ::operator delete(p);
+        }
+    }
+
+    search_arena_t * arena() const { return arena_; }
+
+private:
+    search_arena_t * arena_;
+};
+
+template<typename T, typename U>
+bool operator==(arena_allocator_t<T> const& a, arena_allocator_t<U> const& b) {
+    return a.arena() == b.arena();
+}
+
+template<typename T, typename U>
+bool operator!=(arena_allocator_t<T> const& a, arena_allocator_t<U> const& b) {
+    return a.arena() != b.arena();
+}
+
+// a hash map whose nodes and buckets come from the arena current when it is created
+template<typename Key, typename Value>
+using arena_unordered_map_t =
+    std::unordered_map<Key, Value, std::hash<Key>, std::equal_to<Key>,
+                       arena_allocator_t<std::pair<Key const, Value>>>;
+
+#endif // ARENA_H
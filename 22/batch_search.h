@@ -0,0 +1,134 @@
+#ifndef BATCH_SEARCH_H
+#define BATCH_SEARCH_H
+
+// A* expanding the best open states in batches, on a pool of threads
+// Generating a state's successors and estimating each one's distance are the costly
+// parts of an expansion, and they depend only on the state. Each round takes up to
+// "batch" of the best open states (in the bucket engine's order), has the pool
+// generate and estimate their successors in parallel, each into its own list, and then
+// merges the lists into the open list one state at a time in the order the states
+// were taken. Everything the merge sees is fixed by the batch size, never by which
+// thread ran what, so the path and counts are the same with any number of threads.
+//
+// A goal taken after other states in a round waits for the next one: a state taken
+// before it may have a successor that reaches the goal sooner. A goal taken first is
+// the best state open, as in plain A*. Successors built on the pool's own threads,
+// which have no arena, take their payloads from the heap.
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <boost/graph/graph_traits.hpp>
+
+#include "bucket_search.h"
+#include "search.h"
+#include "stats.h"
+#include "work_pool.h"
+
+template<typename Graph, typename Heuristic>
+search_result_t<typename boost::graph_traits<Graph>::vertex_descriptor>
+batch_solve(Graph const& g,
+            typename boost::graph_traits<Graph>::vertex_descriptor const& start,
+            Heuristic h,
+            size_t batch,
+            work_pool_t & pool) {
+    using vertex_t = typename boost::graph_traits<Graph>::vertex_descriptor;
+    using workspace_t     = bucket_workspace_t<vertex_t>;
+    using vertex_record_t = typename workspace_t::vertex_record_t;
+    using node_t          = typename workspace_t::node_t;
+
+    // heuristics report unsolvable states as at least this far from the goal
+    constexpr size_t dead_end = std::numeric_limits<int>::max() / 2;
+
+    batch = std::max<size_t>(batch, 1);
+    workspace_t ws;
+    ws.records.emplace();
+    auto & records = *ws.records;
+
+    search_result_t<vertex_t> result;
+
+    size_t start_h = static_cast<size_t>(h(start));
+    if (start_h >= dead_end) {
+        return result;
+    }
+    ws.push(&*records.emplace(start, vertex_record_t{0, false, nullptr}).first, start_h);
+
+    // each expanded state's successors, with their estimates
+    std::vector<node_t *> taken;
+    std::vector<std::vector<std::pair<vertex_t, size_t>>> successors(batch);
+    auto expand = [&](size_t i) {
+        auto & out = successors[i];
+        out.clear();
+        auto edges = out_edges(taken[i]->first, g);
+        for (auto ei = edges.first; ei != edges.second; ++ei) {
+            vertex_t succ = target(*ei, g);
+            size_t succ_h = static_cast<size_t>(h(succ));
+            if (succ_h < dead_end) {
+                out.emplace_back(std::move(succ), succ_h);
+            }
+        }
+    };
+
+    node_t const * goal = nullptr;
+    while (!goal) {
+        taken.clear();
+        while (taken.size() < batch) {
+            node_t * node = ws.pop();
+            if (!node) {
+                break;
+            }
+            if (at_goal(g, node->first)) {
+                if (taken.empty()) {
+                    node->second.closed = true;
+                    ++result.examined;
+                    D22_COUNT(examined);
+                    goal = node;
+                } else {
+                    ws.push(node, node->second.distance + static_cast<size_t>(h(node->first)));
+                }
+                break;
+            }
+            node->second.closed = true;
+            ++result.examined;
+            D22_COUNT(examined);
+            taken.push_back(node);
+        }
+        if (taken.empty()) {
+            break;
+        }
+
+        pool.run(taken.size(), expand);
+
+        for (size_t i = 0; i < taken.size(); ++i) {
+            node_t * node = taken[i];
+            size_t distance = node->second.distance + 1;
+            for (auto & s : successors[i]) {
+                auto it = records.find(s.first);
+                if (it == records.end()) {
+                    it = records.emplace(std::move(s.first),
+                                         vertex_record_t{distance, false, node}).first;
+                    ws.push(&*it, distance + s.second);
+                } else if (distance < it->second.distance) {
+                    // shorter path; reopens the vertex if the heuristic is inconsistent
+                    it->second = vertex_record_t{distance, false, node};
+                    ws.push(&*it, distance + s.second);
+                }
+            }
+        }
+        D22_PEAK(open_peak, ws.open_count);
+        D22_PROGRESS(result.examined, ws.open_count, ws.lowest);
+    }
+
+    if (goal) {
+        stats::phase_t phase("path");
+        for (node_t const * n = goal; n; n = n->second.predecessor) {
+            result.path.push_back(n->first);
+        }
+        std::reverse(result.path.begin(), result.path.end());
+    }
+    return result;
+}
+
+#endif // BATCH_SEARCH_H
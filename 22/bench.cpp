@@ -0,0 +1,333 @@
+// Scaling benchmark for Advent of Code, Day 22
+// Generates grids over a ladder of sizes and, for each, times parsing, part 1 (viable
+// pairs), the distance tables and part 2 (the search). Each size runs in a child
+// process so its peak resident set size can be measured on its own. Results go to
+// standard output and optionally to CSV and JSON files, for comparing builds.
+// --capacity 32 runs everything on 32-bit capacity lanes, to measure what the 16-bit
+// instantiation saves. --engine batch with --threads compares the batched parallel
+// expansion's throughput against one thread; its expansion counts do not depend on the
+// thread count. --engine hda runs hash-distributed A* over a ladder of thread counts
+// (1, 2, 4, 8 and 16 unless --threads lists others) to show how its throughput scales.
+// --scalar-kernels replaces the vector grid kernels (finding walls, counting viable
+// pairs, listing receivers) with their scalar loops, to measure what they save.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <boost/program_options.hpp>
+
+#include "batch_search.h"
+#include "bucket_search.h"
+#include "generator.h"
+#include "hda_search.h"
+#include "graph.h"
+#include "heuristic.h"
+#include "loader.h"
+#include "reduced_graph.h"
+#include "search.h"
+#include "viable_pairs.h"
+#include "work_pool.h"
+
+namespace {
+
+struct measurement_t {
+    size_t width;
+    size_t height;
+    unsigned capacity_bits;
+    size_t threads;
+    double parse_s;
+    double grid_s;
+    size_t viable_pairs;
+    double part1_s;
+    double tables_s;
+    double search_s;
+    size_t steps;          // 0 if no solution
+    size_t examined;
+    long   peak_rss_kb;
+};
+
+using seconds = std::chrono::duration<double>;
+
+template<typename F>
+double
+timed(F f) {
+    auto begin = std::chrono::steady_clock::now();
+    f();
+    return seconds(std::chrono::steady_clock::now() - begin).count();
+}
+
+// everything after parsing, on capacity lanes of the given type
+template<typename Capacity>
+void
+measure_grid(df_listing_t const& listing, std::string const& engine, size_t threads,
+             size_t batch, bool full_state, measurement_t & m) {
+    m.capacity_bits = 8 * sizeof(Capacity);
+    std::unique_ptr<basic_grid_t<Capacity>> grid_lanes;
+    std::unique_ptr<basic_move_graph_t<Capacity>> graph;
+    m.grid_s = timed([&]() {
+        grid_lanes.reset(new basic_grid_t<Capacity>(listing.servers, listing.usages));
+        graph.reset(new basic_move_graph_t<Capacity>(*grid_lanes));
+    });
+    auto const & grid = *grid_lanes;
+    auto const & g = *graph;
+
+    m.part1_s = timed([&]() { m.viable_pairs = count_viable_pairs(grid); });
+
+    std::unique_ptr<basic_distance_tables_t<Capacity>> tables;
+    m.tables_s = timed([&]() { tables.reset(new basic_distance_tables_t<Capacity>(g)); });
+    basic_server_move_heuristic_t<Capacity> h(g, *tables);
+
+    work_pool_t pool((engine == "batch") ? threads : 1);
+    auto run = [&](auto const& graph, auto const& start) {
+        auto result = (engine == "astar") ? astar_solve(graph, start, h) :
+                      (engine == "batch") ? batch_solve(graph, start, h, batch, pool) :
+                      (engine == "hda")   ? hda_solve(graph, start, h, threads) :
+                                            bucket_solve(graph, start, h);
+        m.steps = result.found() ? (result.path.size() - 1) : 0;
+        m.examined = result.examined;
+    };
+    m.search_s = timed([&]() {
+        if (!full_state && g.abstraction_sound() &&
+            (g.holes().size() <= reduced_state_t::max_holes)) {
+            basic_reduced_move_graph_t<Capacity> reduced(g);
+            run(reduced, reduced.initial_state());
+        } else {
+            run(g, g.initial_state());
+        }
+    });
+}
+
+// everything for one grid size; runs in the child process
+measurement_t
+measure(grid_spec_t const& spec, std::string const& scratch_fn, std::string const& engine,
+        size_t threads, size_t batch, bool full_state, unsigned bits) {
+    measurement_t m{};
+    m.width = spec.width;
+    m.height = spec.height;
+    m.threads = threads;
+    {
+        std::ofstream out(scratch_fn);
+        write_df(out, generate_grid(spec));
+    }
+
+    df_listing_t listing;
+    m.parse_s = timed([&]() { listing = load_df(scratch_fn); });
+    if (std::max(bits, capacity_bits(listing.servers)) == 16) {
+        measure_grid<std::int16_t>(listing, engine, threads, batch, full_state, m);
+    } else {
+        measure_grid<std::int32_t>(listing, engine, threads, batch, full_state, m);
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    m.peak_rss_kb = usage.ru_maxrss;
+    return m;
+}
+
+}
+
+int main(int argc, char **argv) {
+    using namespace std;
+
+    namespace po = boost::program_options;
+    grid_spec_t spec;
+    po::options_description visible("usage: d22_bench [options]\noptions");
+    visible.add_options()
+        ("help,h", "show this message")
+        ("sizes", po::value<string>()->default_value("10x10,20x20,40x40,80x80,160x160,320x320"),
+         "comma-separated WxH grid sizes")
+        ("walls", po::value<double>(&spec.wall_density)->default_value(spec.wall_density),
+         "fraction of servers that are walls")
+        ("empty", po::value<size_t>(&spec.empty_count)->default_value(spec.empty_count),
+         "number of empty servers")
+        ("seed", po::value<std::uint64_t>(&spec.seed)->default_value(spec.seed),
+         "random seed")
+        ("engine", po::value<string>()->default_value("bucket"),
+         "search engine: \"bucket\", \"astar\" (Boost.Graph), \"batch\" (bucket order, "
+         "expanding batches of states in parallel), or \"hda\" (hash-distributed A*)")
+        ("threads", po::value<string>()->default_value("1"),
+         "comma-separated thread counts to measure each size with (0 for all cores): "
+         "threads expanding each batch with --engine batch, search threads with --engine "
+         "hda, where the default is 1,2,4,8,16")
+        ("batch-size", po::value<size_t>()->default_value(64),
+         "with --engine batch, states expanded together each round")
+        ("full-state", "search over full server usages even when the reduced "
+                       "(hole + data) state space is equivalent")
+        ("scalar-kernels", "use scalar loops instead of the vector grid kernels")
+        ("capacity", po::value<unsigned>()->default_value(16),
+         "narrowest capacity lanes to use, 16 or 32 bits")
+        ("csv", po::value<string>(), "also write the results to this CSV file")
+        ("json", po::value<string>(), "also write the results to this JSON file");
+
+    po::variables_map opts;
+    try {
+        po::store(po::parse_command_line(argc, argv, visible), opts);
+        if (opts.count("help")) {
+            cout << visible;
+            return 0;
+        }
+        po::notify(opts);
+    } catch (po::error const& e) {
+        cerr << e.what() << "\n" << visible;
+        return 1;
+    }
+    string engine = opts["engine"].as<string>();
+    if ((engine != "bucket") && (engine != "astar") && (engine != "batch") && (engine != "hda")) {
+        cerr << "unknown engine " << engine << "\n";
+        return 1;
+    }
+    vector<size_t> thread_counts;
+    {
+        istringstream list(((engine == "hda") && opts["threads"].defaulted()) ?
+                           string("1,2,4,8,16") : opts["threads"].as<string>());
+        string item;
+        while (getline(list, item, ',')) {
+            size_t t;
+            istringstream count(item);
+            if (!(count >> t) || !count.eof()) {
+                cerr << "bad thread count " << item << "\n";
+                return 1;
+            }
+            thread_counts.push_back((t == 0) ? max(1u, thread::hardware_concurrency()) : t);
+        }
+    }
+    if ((engine != "batch") && (engine != "hda")) {
+        thread_counts.assign(1, 1);           // the others are sequential
+    }
+    size_t batch = opts["batch-size"].as<size_t>();
+    unsigned bits = opts["capacity"].as<unsigned>();
+    if ((bits != 16) && (bits != 32)) {
+        cerr << "capacity lanes must be 16 or 32 bits\n";
+        return 1;
+    }
+
+    vector<pair<size_t, size_t>> sizes;
+    {
+        istringstream list(opts["sizes"].as<string>());
+        string item;
+        while (getline(list, item, ',')) {
+            size_t w, h;
+            char x;
+            istringstream dims(item);
+            if (!(dims >> w >> x >> h) || (x != 'x')) {
+                cerr << "bad size " << item << "\n";
+                return 1;
+            }
+            sizes.emplace_back(w, h);
+        }
+    }
+
+    char scratch[] = "/tmp/d22_bench_XXXXXX";
+    int scratch_fd = mkstemp(scratch);
+    if (scratch_fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(scratch_fd);
+
+    use_vector_kernels(!opts.count("scalar-kernels"));
+
+    vector<measurement_t> results;
+    cout << "kernels: " << grid_kernel_name() << "\n";
+    if (engine == "batch") {
+        cout << "batches of " << batch << "\n";
+    }
+    cout << "size       bits threads  parse_s   grid_s  part1_s  tables_s  search_s  steps  expanded  "
+            "expanded/s  peak_rss_kb\n";
+    vector<tuple<size_t, size_t, size_t>> runs;      // width, height, threads
+    for (auto const& wh : sizes) {
+        for (size_t threads : thread_counts) {
+            runs.emplace_back(wh.first, wh.second, threads);
+        }
+    }
+    for (auto const& run : runs) {
+        spec.width = get<0>(run);
+        spec.height = get<1>(run);
+        size_t threads = get<2>(run);
+
+        // measure in a child, which reports back through a pipe
+        int fds[2];
+        if (pipe(fds) != 0) {
+            perror("pipe");
+            return 1;
+        }
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            measurement_t m;
+            try {
+                m = measure(spec, scratch, engine, threads, batch, opts.count("full-state"),
+                            bits);
+            } catch (exception const& e) {
+                cerr << spec.width << "x" << spec.height << ": " << e.what() << "\n";
+                _exit(1);
+            }
+            ssize_t written = write(fds[1], &m, sizeof(m));
+            _exit((written == sizeof(m)) ? 0 : 1);
+        }
+        close(fds[1]);
+        measurement_t m;
+        bool ok = (read(fds[0], &m, sizeof(m)) == sizeof(m));
+        close(fds[0]);
+        int status;
+        waitpid(pid, &status, 0);
+        if (!ok || !WIFEXITED(status) || (WEXITSTATUS(status) != 0)) {
+            cerr << "benchmark failed for " << spec.width << "x" << spec.height
+                 << " on " << threads << " threads\n";
+            continue;
+        }
+        results.push_back(m);
+
+        char line[256];
+        snprintf(line, sizeof(line),
+                 "%-10s %4u %7zu %8.4f %8.4f %8.4f %9.4f %9.4f %6zu %9zu %11.0f %12ld\n",
+                 (to_string(m.width) + "x" + to_string(m.height)).c_str(), m.capacity_bits,
+                 m.threads, m.parse_s, m.grid_s, m.part1_s, m.tables_s, m.search_s, m.steps, m.examined,
+                 m.examined / m.search_s, m.peak_rss_kb);
+        cout << line << flush;
+    }
+    unlink(scratch);
+
+    if (opts.count("csv")) {
+        ofstream csv(opts["csv"].as<string>());
+        csv << "width,height,capacity_bits,threads,parse_s,grid_s,viable_pairs,part1_s,"
+               "tables_s,search_s,steps,expanded,expanded_per_s,peak_rss_kb\n";
+        for (auto const& m : results) {
+            csv << m.width << "," << m.height << "," << m.capacity_bits << ","
+                << m.threads << "," << m.parse_s << "," << m.grid_s << ","
+                << m.viable_pairs << "," << m.part1_s << "," << m.tables_s << "," << m.search_s << "," << m.steps << ","
+                << m.examined << "," << (m.examined / m.search_s) << "," << m.peak_rss_kb << "\n";
+        }
+    }
+    if (opts.count("json")) {
+        ofstream json(opts["json"].as<string>());
+        json << "[\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            auto const& m = results[i];
+            json << "  {\"width\": " << m.width << ", \"height\": " << m.height
+                 << ", \"capacity_bits\": " << m.capacity_bits << ", \"threads\": " << m.threads
+                 << ", \"parse_s\": " << m.parse_s << ", \"grid_s\": " << m.grid_s
+                 << ", \"viable_pairs\": " << m.viable_pairs
+                 << ", \"part1_s\": " << m.part1_s << ", \"tables_s\": " << m.tables_s
+                 << ", \"search_s\": " << m.search_s << ", \"steps\": " << m.steps
+                 << ", \"expanded\": " << m.examined
+                 << ", \"expanded_per_s\": " << (m.examined / m.search_s)
+                 << ", \"peak_rss_kb\": " << m.peak_rss_kb << "}"
+                 << ((i + 1 < results.size()) ? ",\n" : "\n");
+        }
+        json << "]\n";
+    }
+    return results.size() == runs.size() ? 0 : 1;
+}
@@ -0,0 +1,205 @@
+#ifndef BIDIRECTIONAL_SEARCH_H
+#define BIDIRECTIONAL_SEARCH_H
+
+// Bidirectional A*: one search forward from the start, another backward from every
+// goal state at once, for graphs whose moves can all be undone (so the backward search
+// can use the same out edges)
+//
+// Whenever either side reaches a state the other side has already reached, the two
+// paths together give a solution. The best one found so far is optimal once its length
+// is no more than a lower bound on any solution still undiscovered. Three such bounds
+// hold however the two sides take turns:
+//  - the smallest f on the forward open list (the forward heuristic is admissible)
+//  - likewise for the backward open list
+//  - the smallest g on the forward open list plus the smallest g on the backward one,
+//    plus one, since an undiscovered path has an unexpanded state on each frontier and
+//    at least one move between them
+// Each turn goes to the side with the smaller open list.
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include <boost/graph/graph_traits.hpp>
+
+#include "arena.h"
+#include "search.h"
+#include "stats.h"
+
+template<typename Graph, typename ForwardHeuristic, typename BackwardHeuristic>
+search_result_t<typename boost::graph_traits<Graph>::vertex_descriptor>
+bidirectional_solve(Graph const& g,
+                    typename boost::graph_traits<Graph>::vertex_descriptor const& start,
+                    std::vector<typename boost::graph_traits<Graph>::vertex_descriptor> const& goals,
+                    ForwardHeuristic h_forward,      // estimates distance to the nearest goal
+                    BackwardHeuristic h_backward) {  // estimates distance from start
+    using vertex_t = typename boost::graph_traits<Graph>::vertex_descriptor;
+
+    // heuristics report unsolvable states as at least this far from the goal
+    constexpr size_t dead_end = std::numeric_limits<int>::max() / 2;
+    constexpr size_t unbounded = std::numeric_limits<size_t>::max();
+
+    struct vertex_record_t {
+        size_t                                              distance;
+        bool                                                open;
+        std::pair<vertex_t const, vertex_record_t> const *  predecessor;   // map entry
+    };
+    using records_t = arena_unordered_map_t<vertex_t, vertex_record_t>;
+    using node_t    = typename records_t::value_type;
+
+    struct open_entry_t {
+        size_t   f;
+        size_t   distance;
+        node_t * node;
+    };
+    // lowest f first, breaking ties toward the deepest state
+    struct open_order_t {
+        bool operator()(open_entry_t const& a, open_entry_t const& b) const {
+            return (a.f > b.f) || ((a.f == b.f) && (a.distance < b.distance));
+        }
+    };
+
+    struct side_t {
+        records_t                                                                  records;
+        std::priority_queue<open_entry_t, std::vector<open_entry_t>, open_order_t> open;
+        std::vector<size_t>  open_at_distance;        // open states, counted by g
+        size_t               open_count = 0;
+        size_t               min_distance = unbounded; // no open state has a smaller g
+        size_t               examined = 0;
+
+        // the best current open entry, dropping any made stale by a shorter path
+        open_entry_t const * top() {
+            while (!open.empty()) {
+                open_entry_t const & e = open.top();
+                if (e.node->second.open && (e.node->second.distance == e.distance)) {
+                    return &e;
+                }
+                open.pop();
+            }
+            return nullptr;
+        }
+
+        size_t smallest_open_distance() {
+            while ((min_distance < open_at_distance.size()) &&
+                   (open_at_distance[min_distance] == 0)) {
+                ++min_distance;
+            }
+            return (min_distance < open_at_distance.size()) ? min_distance : unbounded;
+        }
+
+        void close(vertex_record_t & rec) {
+            rec.open = false;
+            --open_at_distance[rec.distance];
+            --open_count;
+        }
+
+        // reach v by a path of the given length, if that is the shortest yet
+        node_t * reach(vertex_t const& v, size_t distance, node_t const * pred, size_t h) {
+            if (h >= dead_end) {
+                return nullptr;
+            }
+            auto it = records.find(v);
+            if (it == records.end()) {
+                it = records.emplace(v, vertex_record_t{distance, false, pred}).first;
+            } else if (distance < it->second.distance) {
+                if (it->second.open) {
+                    close(it->second);
+                }
+                it->second.distance = distance;
+                it->second.predecessor = pred;
+            } else {
+                return nullptr;
+            }
+            it->second.open = true;
+            if (open_at_distance.size() <= distance) {
+                open_at_distance.resize(distance + 1);
+            }
+            ++open_at_distance[distance];
+            ++open_count;
+            min_distance = std::min(min_distance, distance);
+            open.push(open_entry_t{distance + h, distance, &*it});
+            return &*it;
+        }
+    };
+    side_t forward, backward;
+
+    size_t best = unbounded;             // length of the best solution found
+    node_t const * meet_forward = nullptr;
+    node_t const * meet_backward = nullptr;
+
+    // a state just reached on one side; see whether the other side has been there
+    auto check_meeting = [&](node_t const * n, side_t & other, bool from_forward) {
+        auto it = other.records.find(n->first);
+        if ((it != other.records.end()) && (n->second.distance + it->second.distance < best)) {
+            best = n->second.distance + it->second.distance;
+            meet_forward  = from_forward ? n : &*it;
+            meet_backward = from_forward ? &*it : n;
+        }
+    };
+
+    for (auto const& goal : goals) {
+        backward.reach(goal, 0, nullptr, static_cast<size_t>(h_backward(goal)));
+    }
+    if (node_t * n = forward.reach(start, 0, nullptr, static_cast<size_t>(h_forward(start)))) {
+        check_meeting(n, backward, true);
+    }
+
+    auto expand = [&](side_t & self, side_t & other, bool is_forward) {
+        node_t * node = self.top()->node;
+        self.open.pop();
+        self.close(node->second);
+        ++self.examined;
+        D22_COUNT(examined);
+        size_t distance = node->second.distance + 1;
+        auto edges = out_edges(node->first, g);
+        for (auto ei = edges.first; ei != edges.second; ++ei) {
+            vertex_t succ = target(*ei, g);
+            size_t succ_h = static_cast<size_t>(is_forward ? h_forward(succ) : h_backward(succ));
+            if (node_t * n = self.reach(succ, distance, node, succ_h)) {
+                check_meeting(n, other, is_forward);
+            }
+        }
+    };
+
+    while (true) {
+        open_entry_t const * f_top = forward.top();
+        open_entry_t const * b_top = backward.top();
+        if (!f_top || !b_top) {
+            break;           // one side has run out, so every path has been seen
+        }
+        size_t lower_bound = std::max(f_top->f, b_top->f);
+        lower_bound = std::max(lower_bound, forward.smallest_open_distance() +
+                                            backward.smallest_open_distance() + 1);
+        if (best <= lower_bound) {
+            break;
+        }
+        if (forward.open_count <= backward.open_count) {
+            expand(forward, backward, true);
+        } else {
+            expand(backward, forward, false);
+        }
+        D22_PEAK(open_peak, forward.open_count + backward.open_count);
+        D22_PROGRESS(forward.examined + backward.examined,
+                     forward.open_count + backward.open_count, lower_bound);
+    }
+
+    search_result_t<vertex_t> result;
+    result.examined = forward.examined + backward.examined;
+    result.examined_backward = backward.examined;
+    if (best != unbounded) {
+        stats::phase_t phase("path");
+        for (node_t const * n = meet_forward; n; n = n->second.predecessor) {
+            result.path.push_back(n->first);
+        }
+        std::reverse(result.path.begin(), result.path.end());
+        for (node_t const * n = meet_backward->second.predecessor; n; n = n->second.predecessor) {
+            result.path.push_back(n->first);
+        }
+    }
+    return result;
+}
+
+#endif // BIDIRECTIONAL_SEARCH_H
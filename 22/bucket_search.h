@@ -0,0 +1,195 @@
+#ifndef BUCKET_SEARCH_H
+#define BUCKET_SEARCH_H
+
+// A* specialized for unit edge weights and small integer f values
+// The open list is an array of buckets indexed by f, each an array of stacks indexed by
+// depth, so pushing is O(1) and popping (lowest f, then deepest) is amortized O(1):
+// the lowest nonempty f only moves backward when the heuristic is inconsistent, and
+// within a bucket we only ever scan down from its deepest entry. Vertices are looked
+// up only when reached from a neighbor; the open list refers to their records
+// directly, and each record itself says whether its vertex is closed.
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <boost/graph/graph_traits.hpp>
+#include <boost/optional.hpp>
+
+#include "arena.h"
+#include "search.h"
+#include "stats.h"
+
+// Everything a search allocates, kept between searches: clearing the buckets keeps
+// their memory, so a series of searches over graphs with the same vertex type (as in
+// the solver service) reuses it rather than growing it again. The records come from
+// the arena current when the search starts, and are dropped by clear() so the arena
+// can be reset before the next one.
+template<typename Vertex>
+struct bucket_workspace_t {
+    struct vertex_record_t {
+        size_t                         distance;
+        bool                           closed;
+        std::pair<Vertex const, vertex_record_t> const * predecessor;   // map entry
+    };
+    using records_t = arena_unordered_map_t<Vertex, vertex_record_t>;
+    using node_t    = typename records_t::value_type;        // stable while in the map
+
+    // an open entry is current only if its distance still matches the record's
+    struct open_entry_t {
+        node_t * node;
+        size_t   distance;
+    };
+    struct bucket_t {
+        std::vector<std::vector<open_entry_t>> by_depth;
+        size_t                                 deepest = 0;   // no entries below are deeper
+        size_t                                 count   = 0;
+    };
+
+    boost::optional<records_t> records;     // while a search's results are in use
+    std::vector<bucket_t>      buckets;     // indexed by f; only the first "used" are valid
+    size_t                     used = 0;
+    size_t                     lowest = std::numeric_limits<size_t>::max();  // no entries below
+    size_t                     open_count = 0;                    // including stale entries
+
+    // give up, as if there were no solution, after examining this many vertices (0: never)
+    size_t                     examined_limit = 0;
+
+    void clear() {
+        records = boost::none;
+        for (size_t f = 0; f < used; ++f) {
+            for (auto & stack : buckets[f].by_depth) {
+                stack.clear();
+            }
+            buckets[f].deepest = 0;
+            buckets[f].count = 0;
+        }
+        used = 0;
+        lowest = std::numeric_limits<size_t>::max();
+        open_count = 0;
+    }
+
+    void push(node_t * node, size_t f) {
+        size_t d = node->second.distance;
+        if (buckets.size() <= f) {
+            buckets.resize(f + 1);
+        }
+        used = std::max(used, f + 1);
+        bucket_t & b = buckets[f];
+        if (b.by_depth.size() <= d) {
+            b.by_depth.resize(d + 1);
+        }
+        b.by_depth[d].push_back(open_entry_t{node, d});
+        b.deepest = (b.count == 0) ? d : std::max(b.deepest, d);
+        ++b.count;
+        ++open_count;
+        lowest = std::min(lowest, f);
+    }
+
+    // the best current entry, or nullptr if the open list is exhausted
+    node_t * pop() {
+        for (; lowest < used; ++lowest) {
+            bucket_t & b = buckets[lowest];
+            while (b.count != 0) {
+                auto & stack = b.by_depth[b.deepest];
+                if (stack.empty()) {
+                    --b.deepest;
+                    continue;
+                }
+                open_entry_t e = stack.back();
+                stack.pop_back();
+                --b.count;
+                --open_count;
+                if (!e.node->second.closed && (e.node->second.distance == e.distance)) {
+                    return e.node;
+                }
+            }
+        }
+        return nullptr;
+    }
+};
+
+template<typename Graph, typename Heuristic>
+search_result_t<typename boost::graph_traits<Graph>::vertex_descriptor>
+bucket_solve(Graph const& g,
+             typename boost::graph_traits<Graph>::vertex_descriptor const& start,
+             Heuristic h,
+             bucket_workspace_t<typename boost::graph_traits<Graph>::vertex_descriptor> & ws) {
+    using vertex_t = typename boost::graph_traits<Graph>::vertex_descriptor;
+    using workspace_t     = bucket_workspace_t<vertex_t>;
+    using vertex_record_t = typename workspace_t::vertex_record_t;
+    using node_t          = typename workspace_t::node_t;
+
+    // heuristics report unsolvable states as at least this far from the goal
+    constexpr size_t dead_end = std::numeric_limits<int>::max() / 2;
+
+    ws.clear();
+    ws.records.emplace();
+    auto & records = *ws.records;
+
+    search_result_t<vertex_t> result;
+
+    size_t start_h = static_cast<size_t>(h(start));
+    if (start_h >= dead_end) {
+        return result;
+    }
+    node_t * start_node = &*records.emplace(start, vertex_record_t{0, false, nullptr}).first;
+    ws.push(start_node, start_h);
+
+    node_t const * goal = nullptr;
+    while (node_t * node = ws.pop()) {
+        vertex_record_t & rec = node->second;
+        rec.closed = true;
+        ++result.examined;
+        D22_COUNT(examined);
+        if (at_goal(g, node->first)) {
+            goal = node;
+            break;
+        }
+        if (result.examined == ws.examined_limit) {
+            break;
+        }
+        size_t distance = rec.distance + 1;
+        auto edges = out_edges(node->first, g);
+        for (auto ei = edges.first; ei != edges.second; ++ei) {
+            vertex_t succ = target(*ei, g);
+            auto it = records.find(succ);
+            if (it == records.end()) {
+                size_t succ_h = static_cast<size_t>(h(succ));
+                if (succ_h >= dead_end) {
+                    continue;
+                }
+                it = records.emplace(std::move(succ),
+                                     vertex_record_t{distance, false, node}).first;
+                ws.push(&*it, distance + succ_h);
+            } else if (distance < it->second.distance) {
+                // shorter path; reopens the vertex if the heuristic is inconsistent
+                it->second = vertex_record_t{distance, false, node};
+                ws.push(&*it, distance + static_cast<size_t>(h(it->first)));
+            }
+        }
+        D22_PEAK(open_peak, ws.open_count);
+        D22_PROGRESS(result.examined, ws.open_count, ws.lowest);
+    }
+
+    if (goal) {
+        stats::phase_t phase("path");
+        for (node_t const * n = goal; n; n = n->second.predecessor) {
+            result.path.push_back(n->first);
+        }
+        std::reverse(result.path.begin(), result.path.end());
+    }
+    return result;
+}
+
+template<typename Graph, typename Heuristic>
+search_result_t<typename boost::graph_traits<Graph>::vertex_descriptor>
+bucket_solve(Graph const& g,
+             typename boost::graph_traits<Graph>::vertex_descriptor const& start,
+             Heuristic h) {
+    bucket_workspace_t<typename boost::graph_traits<Graph>::vertex_descriptor> ws;
+    return bucket_solve(g, start, h, ws);
+}
+
+#endif // BUCKET_SEARCH_H
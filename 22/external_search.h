@@ -0,0 +1,168 @@
+#ifndef EXTERNAL_SEARCH_H
+#define EXTERNAL_SEARCH_H
+
+// External-memory search, for state spaces too large to keep in RAM
+// With unit edge weights every state's g is its layer, so the frontier is kept as one
+// file per layer of encoded states (see spill.h). Expanding a layer streams through
+// its file, decoding one state at a time; the successors go to a buffer of bounded
+// size, spilled to sorted runs, and merged into the next layer with every state
+// already in an earlier layer dropped. Moves merging data cannot be undone, so the
+// graph is directed and all earlier layers are checked, not just the last two.
+//
+// Breadth-first search alone would visit every state closer than the goal, so the
+// layers are searched breadth-first iterative deepening style: any state whose g + h
+// exceeds a bound is left out, and if no layer reaches the goal the search starts
+// over with the bound raised to the smallest g + h left out. With an admissible
+// heuristic every state on a shortest path is within the bound that finds it, so the
+// goal is found at its true distance.
+//
+// Each record keeps an id of its predecessor. The path is recovered from the goal
+// back to the start by finding, one layer down each time, a state with that id that
+// has the later state as a successor - a scan of each layer but no extra storage.
+// RAM use is the successor buffer and one state at a time; the layers are read
+// through memory mappings.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/graph/graph_traits.hpp>
+
+#include "arena.h"
+#include "search.h"
+#include "spill.h"
+#include "stats.h"
+
+template<typename Vertex>
+struct external_result_t : search_result_t<Vertex> {
+    size_t layers        = 0;   // most in one iteration, the start's included
+    size_t runs          = 0;   // sorted runs spilled on the way
+    size_t bytes_written = 0;   // to runs and layers
+};
+
+// Search from "start" in "ram_bytes" of buffer, with files in a new directory under
+// "spill_parent". Throws std::system_error if the files cannot be written.
+template<typename Graph, typename Heuristic>
+external_result_t<typename boost::graph_traits<Graph>::vertex_descriptor>
+external_solve(Graph const& g,
+               typename boost::graph_traits<Graph>::vertex_descriptor const& start,
+               Heuristic h,
+               size_t ram_bytes,
+               std::string const& spill_parent) {
+    using vertex_t = typename boost::graph_traits<Graph>::vertex_descriptor;
+    using layers_t = std::vector<std::unique_ptr<spill_layer_t>>;
+
+    // heuristics report unsolvable states as at least this far from the goal
+    constexpr size_t dead_end = std::numeric_limits<int>::max() / 2;
+    constexpr size_t unbounded = std::numeric_limits<size_t>::max();
+
+    external_result_t<vertex_t> result;
+    size_t bound = static_cast<size_t>(h(start));
+    if (bound >= dead_end) {
+        return result;
+    }
+
+    spill_dir_t dir(spill_parent);
+    size_t const key_bytes = g.state_bytes();
+    spill_layer_builder_t builder(dir, key_bytes, ram_bytes);
+    layers_t layers;
+    auto finish_layer = [&]() {
+        layers.push_back(builder.finish("layer-" + std::to_string(layers.size()), layers));
+        result.layers = std::max(result.layers, layers.size());
+        result.runs = builder.runs_written();
+        result.bytes_written = builder.bytes_written();
+        D22_PEAK(open_peak, layers.back()->size());
+    };
+
+    // the states expanded hold nothing once expanded, so one arena serves them all
+    search_arena_t arena;
+    size_t goal_idx = 0;
+    bool found = false;
+    while (!found && (bound != unbounded)) {
+        ++result.iterations;
+        layers.clear();
+        g.encode(start, builder.next_key());
+        builder.add(0);
+        finish_layer();
+
+        size_t next_bound = unbounded;
+        while (!found && (layers.back()->size() != 0)) {
+            spill_layer_t const & layer = *layers.back();
+            size_t distance = layers.size();      // of the successors
+            for (size_t i = 0; (i < layer.size()) && !found; ++i) {
+                {
+                    arena_scope_t scope(&arena);
+                    vertex_t v = g.decode(layer.record(i));
+                    ++result.examined;
+                    D22_COUNT(examined);
+                    if (at_goal(g, v)) {
+                        found = true;
+                        goal_idx = i;
+                        continue;
+                    }
+                    std::uint64_t id = key_id(layer.record(i), key_bytes);
+                    auto edges = out_edges(v, g);
+                    for (auto ei = edges.first; ei != edges.second; ++ei) {
+                        vertex_t succ = target(*ei, g);
+                        size_t succ_h = static_cast<size_t>(h(succ));
+                        if (succ_h >= dead_end) {
+                            continue;
+                        }
+                        if (distance + succ_h > bound) {
+                            next_bound = std::min(next_bound, distance + succ_h);
+                            continue;
+                        }
+                        g.encode(succ, builder.next_key());
+                        builder.add(id);
+                    }
+                    D22_PROGRESS(result.examined, layer.size() - i, bound);
+                }
+                arena.reset();
+            }
+            if (!found) {
+                finish_layer();
+            }
+        }
+        bound = next_bound;
+    }
+    if (!found) {
+        return result;
+    }
+
+    // walk back from the goal; the path's states outlive this search, so no arena
+    stats::phase_t phase("path");
+    arena_scope_t heap(nullptr);
+    std::vector<unsigned char> child(layers.back()->record(goal_idx),
+                                     layers.back()->record(goal_idx) + key_bytes);
+    std::vector<unsigned char> succ_key(key_bytes);
+    std::uint64_t parent = layers.back()->parent(goal_idx);
+    result.path.push_back(g.decode(child.data()));
+    for (size_t k = layers.size() - 1; k-- > 0; ) {
+        spill_layer_t const & layer = *layers[k];
+        bool linked = false;
+        for (size_t j = 0; (j < layer.size()) && !linked; ++j) {
+            if (key_id(layer.record(j), key_bytes) != parent) {
+                continue;
+            }
+            vertex_t v = g.decode(layer.record(j));
+            auto edges = out_edges(v, g);
+            for (auto ei = edges.first; (ei != edges.second) && !linked; ++ei) {
+                g.encode(target(*ei, g), succ_key.data());
+                linked = (succ_key == child);
+            }
+            if (linked) {
+                child.assign(layer.record(j), layer.record(j) + key_bytes);
+                parent = layer.parent(j);
+                result.path.push_back(v);
+            }
+        }
+    }
+    std::reverse(result.path.begin(), result.path.end());
+    return result;
+}
+
+#endif // EXTERNAL_SEARCH_H
@@ -0,0 +1,89 @@
+// Synthetic grid generator for Advent of Code, Day 22
+// Writes df output for a grid of any size, for measuring how the solver scales
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <boost/program_options.hpp>
+
+#include "generator.h"
+
+int main(int argc, char **argv) {
+    using namespace std;
+
+    // parse a range given as "lo-hi", or a single value
+    auto range = [](string const& text, int & lo, int & hi) {
+        size_t dash = text.find('-');
+        lo = stoi(text.substr(0, dash));
+        hi = (dash == string::npos) ? lo : stoi(text.substr(dash + 1));
+    };
+
+    namespace po = boost::program_options;
+    grid_spec_t spec;
+    po::options_description visible("usage: d22_gen [options] [output.txt]\noptions");
+    visible.add_options()
+        ("help,h", "show this message")
+        ("width", po::value<size_t>(&spec.width)->default_value(spec.width), "grid width")
+        ("height", po::value<size_t>(&spec.height)->default_value(spec.height), "grid height")
+        ("walls", po::value<double>(&spec.wall_density)->default_value(spec.wall_density),
+         "fraction of servers that are walls")
+        ("empty", po::value<size_t>(&spec.empty_count)->default_value(spec.empty_count),
+         "number of empty servers")
+        ("capacity", po::value<string>()->default_value("85-94"),
+         "capacity range of ordinary servers, in T")
+        ("used", po::value<string>()->default_value("64-73"),
+         "usage range of ordinary servers, in T")
+        ("wall-capacity", po::value<string>()->default_value("500-510"),
+         "capacity range of walls, in T")
+        ("seed", po::value<std::uint64_t>(&spec.seed)->default_value(spec.seed),
+         "random seed");
+    po::options_description all;
+    all.add(visible).add_options()
+        ("output", po::value<string>(), "file to write (default standard output)");
+    po::positional_options_description positional;
+    positional.add("output", 1);
+
+    po::variables_map opts;
+    try {
+        po::store(po::command_line_parser(argc, argv).
+                  options(all).positional(positional).run(), opts);
+        if (opts.count("help")) {
+            cout << visible;
+            return 0;
+        }
+        po::notify(opts);
+        range(opts["capacity"].as<string>(), spec.min_capacity, spec.max_capacity);
+        range(opts["used"].as<string>(), spec.min_used, spec.max_used);
+        range(opts["wall-capacity"].as<string>(), spec.min_wall_capacity,
+              spec.max_wall_capacity);
+    } catch (po::error const& e) {
+        cerr << e.what() << "\n" << visible;
+        return 1;
+    } catch (logic_error const& e) {     // from stoi
+        cerr << "bad range: " << e.what() << "\n" << visible;
+        return 1;
+    }
+
+    df_listing_t listing;
+    try {
+        listing = generate_grid(spec);
+    } catch (invalid_argument const& e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+
+    if (opts.count("output")) {
+        string output_fn = opts["output"].as<string>();
+        ofstream out(output_fn);
+        if (!out.is_open()) {
+            cerr << "error opening " << output_fn << "\n";
+            return 1;
+        }
+        write_df(out, listing);
+    } else {
+        write_df(cout, listing);
+    }
+    return 0;
+}
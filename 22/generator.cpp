@@ -0,0 +1,123 @@
+// Synthetic grid generation for Advent of Code, Day 22
+
+#include "generator.h"
+
+#include <algorithm>
+#include <limits>
+#include <ostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+df_listing_t
+generate_grid(grid_spec_t const& spec) {
+    using namespace std;
+    using capacity_t = server_t::capacity_t;
+
+    if ((spec.width < 2) || (spec.height < 2)) {
+        throw invalid_argument("grid must be at least 2x2");
+    }
+    if ((spec.min_capacity > spec.max_capacity) || (spec.min_used > spec.max_used) ||
+        (spec.min_wall_capacity > spec.max_wall_capacity) || (spec.min_used < 1) ||
+        (spec.max_used > spec.min_capacity) ||
+        (spec.max_wall_capacity > numeric_limits<capacity_t>::max())) {
+        throw invalid_argument("capacity and usage ranges are inconsistent");
+    }
+    if (spec.min_wall_capacity <= spec.max_capacity) {
+        // a wall's data must be too large for any ordinary server yet fit in the wall
+        throw invalid_argument("wall capacities must exceed every ordinary server's");
+    }
+    size_t n = spec.width * spec.height;
+    if (spec.empty_count + 1 > n) {
+        throw invalid_argument("too many empty servers for the grid");
+    }
+
+    mt19937_64 rng(spec.seed);
+    auto uniform = [&rng](int lo, int hi) { return uniform_int_distribution<int>(lo, hi)(rng); };
+
+    // lay out the walls, row by row, with a free row between any two
+    vector<bool> wall(n, false);       // indexed x * height + y
+    size_t wall_target = static_cast<size_t>(spec.wall_density * n);
+    vector<size_t> rows;
+    for (size_t y = 2; y < spec.height; y += 2) {
+        rows.push_back(y);
+    }
+    shuffle(rows.begin(), rows.end(), rng);
+    size_t walls = 0;
+    for (size_t y : rows) {
+        if (walls >= wall_target) {
+            break;
+        }
+        size_t length = min<size_t>(wall_target - walls, spec.width - 1);
+        length = uniform(1, static_cast<int>(length));
+        bool from_left = uniform(0, 1);
+        for (size_t i = 0; i < length; ++i) {
+            size_t x = from_left ? i : (spec.width - 1 - i);
+            wall[x * spec.height + y] = true;
+        }
+        walls += length;
+    }
+
+    // holes anywhere else but on the target data
+    vector<size_t> candidates;
+    size_t target = (spec.width - 1) * spec.height;
+    for (size_t i = 0; i < n; ++i) {
+        if (!wall[i] && (i != target)) {
+            candidates.push_back(i);
+        }
+    }
+    if (candidates.size() < spec.empty_count) {
+        throw invalid_argument("not enough room for the empty servers");
+    }
+    shuffle(candidates.begin(), candidates.end(), rng);
+    vector<bool> empty(n, false);
+    for (size_t i = 0; i < spec.empty_count; ++i) {
+        empty[candidates[i]] = true;
+    }
+
+    df_listing_t listing;
+    listing.servers.reserve(n);
+    listing.usages.reserve(n);
+    for (size_t x = 0; x < spec.width; ++x) {
+        for (size_t y = 0; y < spec.height; ++y) {
+            size_t i = x * spec.height + y;
+            int capacity, used;
+            if (wall[i]) {
+                capacity = uniform(spec.min_wall_capacity, spec.max_wall_capacity);
+                used = capacity - uniform(spec.min_capacity - spec.max_used,
+                                          spec.max_capacity - spec.min_used);
+                used = max(used, spec.max_capacity + 1);    // too big for any neighbor
+            } else {
+                capacity = uniform(spec.min_capacity, spec.max_capacity);
+                used = empty[i] ? 0 : uniform(spec.min_used, spec.max_used);
+            }
+            listing.servers.push_back(server_t{static_cast<int>(x), static_cast<int>(y),
+                                               static_cast<capacity_t>(capacity)});
+            listing.usages.push_back(static_cast<capacity_t>(used));
+        }
+    }
+    return listing;
+}
+
+void
+write_df(std::ostream & os, df_listing_t const& listing) {
+    // columns padded to the widths in the puzzle input, with at least one space
+    auto pad = [](size_t width, size_t used) {
+        return std::string((used < width) ? (width - used) : 1, ' ');
+    };
+    os << "root@ebhq-gridcenter# df -h\n";
+    os << "Filesystem              Size  Used  Avail  Use%\n";
+    for (size_t i = 0; i < listing.servers.size(); ++i) {
+        auto const& s = listing.servers[i];
+        int used = listing.usages[i];
+        std::string name = "/dev/grid/node-x" + std::to_string(s.x) + "-y" + std::to_string(s.y);
+        std::string size = std::to_string(s.capacity) + "T";
+        std::string use = std::to_string(used) + "T";
+        std::string avail = std::to_string(s.capacity - used) + "T";
+        std::string percent = std::to_string(100 * used / s.capacity) + "%";
+        os << name << pad(28, name.size() + size.size()) << size
+           << pad(6, use.size()) << use << pad(7, avail.size()) << avail
+           << pad(6, percent.size()) << percent << "\n";
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+// Synthetic grids in the style of the puzzle input, for measuring how the solver scales
+// Ordinary servers get a capacity and usage drawn uniformly from the given ranges.
+// Walls are horizontal runs of much larger servers starting at the left or right edge,
+// never on the top two rows and never on adjacent rows, and never spanning a whole
+// row, so every ordinary server stays reachable. The empty servers are placed at
+// random among the ordinary ones, away from the target data in the upper right.
+
+#include <cstdint>
+#include <iosfwd>
+
+#include "loader.h"
+
+struct grid_spec_t {
+    size_t         width        = 38;
+    size_t         height       = 24;
+    double         wall_density = 0.03;     // fraction of all servers
+    size_t         empty_count  = 1;
+    int            min_capacity = 85;
+    int            max_capacity = 94;
+    int            min_used     = 64;
+    int            max_used     = 73;
+    int            min_wall_capacity = 500;
+    int            max_wall_capacity = 510;
+    std::uint64_t  seed         = 1;
+};
+
+// throws std::invalid_argument if the spec cannot be met
+df_listing_t generate_grid(grid_spec_t const& spec);
+
+// as df output, in the layout of the puzzle input
+void write_df(std::ostream & os, df_listing_t const& listing);
+
+#endif // GENERATOR_H
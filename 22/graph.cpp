@@ -3,239 +3,683 @@
 
 #include "graph.h"
 
-move_graph_t::move_graph_t(std::vector<server_t> servers) : servers_(std::move(servers)) {
-    // locate the upper right corner (source data location)
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <sstream>
+
+#include "stats.h"
+
+template<typename Capacity>
+basic_move_graph_t<Capacity>::basic_move_graph_t(grid_type grid)
+    : basic_move_graph_t(grid, grid.offset(grid.width() - 1, 0), 0) {}
+
+template<typename Capacity>
+basic_move_graph_t<Capacity>::basic_move_graph_t(grid_type grid, size_t data_start, size_t goal)
+    : grid_(std::move(grid)), data_start_(data_start), goal_(goal) {
+    if ((data_start_ >= grid_.size()) || (goal_ >= grid_.size())) {
+        throw std::invalid_argument("target data start or goal outside the grid");
+    }
+
+    classify();
+
+    receiver_threshold_ = std::numeric_limits<capacity_t>::max();
+    for (size_t i = 0; i < grid_.size(); ++i) {
+        if (grid_.usage(i) != 0) {
+            receiver_threshold_ = std::min(receiver_threshold_, grid_.usage(i));
+        }
+    }
+}
+
+template<typename Capacity>
+typename basic_move_graph_t<Capacity>::vertex_t
+basic_move_graph_t<Capacity>::initial_state() const {
+    // find receivers 64 servers at a time
+    std::vector<std::uint64_t> mask((grid_.size() + 63) / 64);
+    at_least_mask(grid_.avails(), grid_.size(), receiver_threshold_, mask.data());
+    std::vector<std::uint32_t> receivers;
+    for (size_t w = 0; w < mask.size(); ++w) {
+        for (std::uint64_t bits = mask[w]; bits; bits &= bits - 1) {
+            receivers.push_back(static_cast<std::uint32_t>(w * 64 + __builtin_ctzll(bits)));
+        }
+    }
+    return vertex_t(data_start_, grid_.usages(), grid_.usages() + grid_.size(),
+                    std::move(receivers));
+}
+
+template<typename Capacity>
+move_t
+basic_move_graph_t<Capacity>::move(vertex_t const& from, vertex_t const& to) const {
+    if (from.data_offset() != to.data_offset()) {
+        return move_t{from.data_offset(), to.data_offset()};
+    }
+    // data only ever moves into a receiver, from a neighbor it leaves empty
+    for (size_t dst : from.receivers()) {
+        if (from.usage(dst) == to.usage(dst)) {
+            continue;
+        }
+        for (grid_neighbor dir = grid_neighbor::North; dir <= grid_neighbor::West; ++dir) {
+            size_t src = neighbor(dst, dir);
+            if ((src != grid_.size()) && (from.usage(src) != 0) && (to.usage(src) == 0)) {
+                return move_t{src, dst};
+            }
+        }
+    }
+    throw std::invalid_argument("states are not one move apart");
+}
 
-    // first find the largest x (column) value
+template<typename Capacity>
+size_t
+basic_move_graph_t<Capacity>::state_bytes() const {
+    return sizeof(std::uint32_t) + grid_.size() * sizeof(capacity_t);
+}
+
+template<typename Capacity>
+void
+basic_move_graph_t<Capacity>::encode(vertex_t const& v, unsigned char * out) const {
+    auto data = static_cast<std::uint32_t>(v.data_offset());
+    std::memcpy(out, &data, sizeof(data));
+    out += sizeof(data);
+    for (size_t i = 0; i < grid_.size(); ++i, out += sizeof(capacity_t)) {
+        capacity_t u = v.usage(i);
+        std::memcpy(out, &u, sizeof(u));
+    }
+}
+
+template<typename Capacity>
+typename basic_move_graph_t<Capacity>::vertex_t
+basic_move_graph_t<Capacity>::decode(unsigned char const * in) const {
+    std::uint32_t data;
+    std::memcpy(&data, in, sizeof(data));
+    in += sizeof(data);
+    std::vector<capacity_t> usages(grid_.size());
+    std::memcpy(usages.data(), in, usages.size() * sizeof(capacity_t));
+    std::vector<std::uint32_t> receivers;
+    for (size_t i = 0; i < usages.size(); ++i) {
+        if ((grid_.capacity(i) - usages[i]) >= receiver_threshold_) {
+            receivers.push_back(static_cast<std::uint32_t>(i));
+        }
+    }
+    return vertex_t(data, usages.begin(), usages.end(), std::move(receivers));
+}
+
+template<typename Capacity>
+typename basic_move_graph_t<Capacity>::capacity_t
+basic_move_graph_t<Capacity>::receiver_threshold() const {
+    return receiver_threshold_;
+}
+
+// Sort servers into walls, movable servers, and holes, and check whether doing so
+// gives a reduced state space equivalent to the full one
+template<typename Capacity>
+void
+basic_move_graph_t<Capacity>::classify() {
     using namespace std;
-    int largest_x = max_element(servers_.begin(), servers_.end(),
-                                [](server_t const& a, server_t const& b) {
-                                    return a.x < b.x;
-                                })->x;
 
-    // then locate the y=0 matching that x, and calculate its offset among the servers
-    ur_corner_ =
-        distance(servers_.begin(),
-                 find_if(servers_.begin(), servers_.end(),
-                         [largest_x](server_t const& s) {
-                             return ((s.x == largest_x) && (s.y == 0));
-                         }));
+    auto usages = grid_.usages();
+    classes_.assign(grid_.size(), server_class::Movable);
+    holes_.clear();
+    for (size_t i = 0; i < grid_.size(); ++i) {
+        if (usages[i] == 0) {
+            classes_[i] = server_class::Empty;
+            holes_.push_back(i);
+        }
+    }
+    if (holes_.empty()) {
+        abstraction_problem_ = "no empty servers";
+        return;
+    }
+
+    // anything too large to fit in a hole can never move
+    int hole_capacity = numeric_limits<int>::max();
+    for (size_t h : holes_) {
+        hole_capacity = min<int>(hole_capacity, grid_.capacity(h));
+    }
+    for (size_t i = 0; i < grid_.size(); ++i) {
+        if (usages[i] > hole_capacity) {
+            classes_[i] = server_class::Wall;
+        }
+    }
 
-    // finally figure out how many entries correspond to a single column
-    col_stride_ = max_element(servers_.begin(), servers_.end(),
-                              [](server_t const& a, server_t const& b) {
-                                  return a.y < b.y;
-                              })->y + 1;
+    // gather the extremes the soundness conditions depend on
+    int max_usage = 0;                                  // largest movable data
+    int min_usage = numeric_limits<int>::max();         // smallest movable data
+    int next_usage = numeric_limits<int>::max();        // second smallest
+    int min_cap = numeric_limits<int>::max();           // of servers data may move into
+    int max_cap = 0;
+    int max_wall_avail = numeric_limits<int>::min();
+    for (size_t i = 0; i < grid_.size(); ++i) {
+        if (classes_[i] == server_class::Wall) {
+            max_wall_avail = max<int>(max_wall_avail, grid_.avail(i));
+            continue;
+        }
+        min_cap = min<int>(min_cap, grid_.capacity(i));
+        max_cap = max<int>(max_cap, grid_.capacity(i));
+        if (classes_[i] == server_class::Movable) {
+            max_usage = max<int>(max_usage, usages[i]);
+            if (usages[i] < min_usage) {
+                next_usage = min_usage;
+                min_usage = usages[i];
+            } else {
+                next_usage = min<int>(next_usage, usages[i]);
+            }
+        }
+    }
+
+    ostringstream problem;
+    if (classes_[data_start_] != server_class::Movable) {
+        problem << "target data server is not movable";
+    } else if (classes_[goal_] == server_class::Wall) {
+        problem << "destination server is a wall";
+    } else if (max_usage > min_cap) {
+        // movable data must fit wherever a hole may wander
+        problem << "movable data of " << max_usage << " does not fit in every server";
+    } else if ((next_usage != numeric_limits<int>::max()) &&
+               ((min_usage + next_usage) <= max_cap)) {
+        // two pieces of data could be merged into a single server
+        problem << "movable data of " << min_usage << " and " << next_usage << " could be merged";
+    } else if ((max_wall_avail != numeric_limits<int>::min()) && (min_usage <= max_wall_avail)) {
+        problem << "movable data of " << min_usage << " fits into a wall";
+    } else {
+        // finally, walls themselves must be unable to move anywhere
+        for (size_t i = 0; i < grid_.size() && problem.tellp() == 0; ++i) {
+            if (classes_[i] != server_class::Wall) {
+                continue;
+            }
+            for (grid_neighbor dir = grid_neighbor::North; dir <= grid_neighbor::West; ++dir) {
+                size_t n = neighbor(i, dir);
+                if (n == grid_.size()) {
+                    continue;
+                }
+                // a non-wall neighbor may become empty at some point
+                int room = (classes_[n] == server_class::Wall) ?
+                    grid_.avail(n) : grid_.capacity(n);
+                if (usages[i] <= room) {
+                    problem << "wall at x" << grid_.x(i) << "-y" << grid_.y(i)
+                            << " can move";
+                    break;
+                }
+            }
+        }
+    }
+    abstraction_problem_ = problem.str();
+}
 
+template<typename Capacity>
+server_class
+basic_move_graph_t<Capacity>::classification(size_t offset) const {
+    return classes_[offset];
+}
+
+template<typename Capacity>
+std::vector<size_t> const &
+basic_move_graph_t<Capacity>::holes() const {
+    return holes_;
+}
+
+template<typename Capacity>
+bool
+basic_move_graph_t<Capacity>::abstraction_sound() const {
+    return abstraction_problem_.empty();
+}
+
+template<typename Capacity>
+std::string const &
+basic_move_graph_t<Capacity>::abstraction_problem() const {
+    return abstraction_problem_;
+}
+
+template<typename Capacity>
+size_t
+basic_move_graph_t<Capacity>::neighbor(size_t offset, grid_neighbor dir) const {
+    return grid_.neighbor(offset, dir);
 }
 
 // IncidenceGraph free functions
 
-move_graph_t::vertex_t source(move_graph_t::edge_t const& e, move_graph_t const&) {
+template<typename Capacity>
+basic_server_state_t<Capacity>
+source(std::pair<basic_server_state_t<Capacity>, basic_server_state_t<Capacity>> const& e,
+       basic_move_graph_t<Capacity> const&) {
     return e.first;
 }
 
-move_graph_t::vertex_t target(move_graph_t::edge_t const& e, move_graph_t const&) {
+template<typename Capacity>
+basic_server_state_t<Capacity>
+target(std::pair<basic_server_state_t<Capacity>, basic_server_state_t<Capacity>> const& e,
+       basic_move_graph_t<Capacity> const&) {
     return e.second;
 }
 
-std::vector<server_t> const &
-move_graph_t::servers() const {
-    return servers_;
+template<typename Capacity>
+typename basic_move_graph_t<Capacity>::grid_type const &
+basic_move_graph_t<Capacity>::grid() const {
+    return grid_;
 }
 
+template<typename Capacity>
 size_t
-move_graph_t::col_stride() const {
-    return col_stride_;
+basic_move_graph_t<Capacity>::data_start() const {
+    return data_start_;
 }
 
+template<typename Capacity>
 size_t
-move_graph_t::ur_corner() const {
-    return ur_corner_;
+basic_move_graph_t<Capacity>::goal() const {
+    return goal_;
 }
 
-std::pair<move_graph_t::out_edge_iterator_t, move_graph_t::out_edge_iterator_t>
-out_edges(move_graph_t::vertex_t const& u, move_graph_t const& g) {
+template<typename Capacity>
+std::pair<typename basic_move_graph_t<Capacity>::out_edge_iterator_t,
+          typename basic_move_graph_t<Capacity>::out_edge_iterator_t>
+out_edges(basic_server_state_t<Capacity> const& u, basic_move_graph_t<Capacity> const& g) {
+    using iterator_t = typename basic_move_graph_t<Capacity>::out_edge_iterator_t;
 
-    return std::make_pair(
-        move_graph_t::out_edge_iterator_t(&g, std::make_shared<move_graph_t::vertex_t>(u)),
-        move_graph_t::out_edge_iterator_t());
+    return std::make_pair(iterator_t(&g, u), iterator_t());
             
 }
 
-// Implementations for internal iterator class
-
-grid_neighbor&
-operator++(grid_neighbor& gn) {
-    if (gn == grid_neighbor::North) {
-        gn = grid_neighbor::South;
-    } else if (gn == grid_neighbor::South) {
-        gn = grid_neighbor::East;
-    } else if (gn == grid_neighbor::East) {
-        gn = grid_neighbor::West;
-    } else {
-        gn = grid_neighbor::Invalid;
-    }
-    return gn;
+template<typename Capacity>
+size_t
+out_degree(basic_server_state_t<Capacity> const& u, basic_move_graph_t<Capacity> const& g) {
+    auto edges = out_edges(u, g);
+    return std::distance(edges.first, edges.second);
 }
 
-move_graph_t::out_edge_iterator_t::out_edge_iterator_t() : sentinel_(true) {}
+// Implementations for internal iterator class
 
-move_graph_t::out_edge_iterator_t::out_edge_iterator_t(
-    move_graph_t const *      g,
-    std::shared_ptr<vertex_t> source)
-    : move_graph_(g), source_(std::move(source)),
+template<typename Capacity>
+basic_move_graph_t<Capacity>::out_edge_iterator_t::out_edge_iterator_t()
+    : move_graph_(nullptr), sentinel_(true),
+      receiver_idx_(0), src_dir_(grid_neighbor::Invalid) {}
+
+template<typename Capacity>
+basic_move_graph_t<Capacity>::out_edge_iterator_t::out_edge_iterator_t(
+    basic_move_graph_t const * g,
+    vertex_t const &     source)
+    : move_graph_(g), source_(source),
       sentinel_(false),
-      src_server_(0), dst_server_(grid_neighbor::North) {
+      receiver_idx_(0), src_dir_(grid_neighbor::North) {
 
     ensure_valid();                          // move forward to valid move, if needed
 }
       
-move_graph_t::edge_t
-move_graph_t::out_edge_iterator_t::dereference() const {
+template<typename Capacity>
+typename basic_move_graph_t<Capacity>::edge_t
+basic_move_graph_t<Capacity>::out_edge_iterator_t::dereference() const {
     // assuming user has not tried to dereference the end iterator
-    return std::make_pair(*source_, source_->state_if_move(src_server_, dst_offset()));
+    return std::make_pair(source_, source_.state_if_move(src_server(), dst_server(), *move_graph_));
 }
 
+template<typename Capacity>
 bool
-move_graph_t::out_edge_iterator_t::equal(out_edge_iterator_t const& other) const {
+basic_move_graph_t<Capacity>::out_edge_iterator_t::equal(out_edge_iterator_t const& other) const {
     if (sentinel_ && other.sentinel_) {
         // both "end of sequence" so other fields irrelevant
         return true;
     }
-    return ((sentinel_    == other.sentinel_) &&
-            (source_      == other.source_) &&
-            (src_server_  == other.src_server_) &&
-            (dst_server_  == other.dst_server_));
+    return ((sentinel_     == other.sentinel_) &&
+            (source_       == other.source_) &&
+            (receiver_idx_ == other.receiver_idx_) &&
+            (src_dir_      == other.src_dir_));
 
 }            
     
+template<typename Capacity>
 void
-move_graph_t::out_edge_iterator_t::increment() {
+basic_move_graph_t<Capacity>::out_edge_iterator_t::increment() {
     if (!sentinel_) {
         // push out of current state, then look for next valid
-        ++dst_server_;
+        ++src_dir_;
         ensure_valid();
     }
 }
 
 // code for searching for a valid move.  Used to keep iterators legit (either valid or "end")
+template<typename Capacity>
 void
-move_graph_t::out_edge_iterator_t::ensure_valid() {
+basic_move_graph_t<Capacity>::out_edge_iterator_t::ensure_valid() {
     if (sentinel_) {
         return;           // end of sequence is always fine
     }
 
-    std::vector<server_t> const& servers = move_graph_->servers();
+    grid_type const& grid = move_graph_->grid();
+    typename vertex_t::receivers_t const& receivers = source_.receivers();
 
     // if the current src/dst pair is not valid, advance it to one that is.
     // if there is no such pair, set the end sentinel
 
-    for (; src_server_ < servers.size(); ++src_server_) {
-        for (; dst_server_ <= grid_neighbor::West; ++dst_server_) {
-            // find the offset of the destination
-            size_t offset = dst_offset();
-            if (offset >= servers.size()) {
-                // invalid neighbor due to edge; try the next one
+    for (; receiver_idx_ < receivers.size(); ++receiver_idx_) {
+        size_t dst = dst_server();
+        int dst_avail = grid.capacity(dst) - source_.usage(dst);
+        for (; src_dir_ <= grid_neighbor::West; ++src_dir_) {
+            // find the offset of the source
+            size_t src = src_server();
+            if (src >= grid.size()) {                   // invalid neighbor due to edge
+                D22_COUNT(rejected_off_grid);
+                continue;
+            }
+            if (grid.wall(src)) {                       // or data too large to go anywhere
+                D22_COUNT(rejected_wall);
                 continue;
             }
 
-            if ((source_->usage(src_server_) == 0) ||                    // no source data
-                (src_server_ == offset) ||                               // same src, dst
-                (source_->usage(src_server_) >
-                 (servers[offset].capacity - source_->usage(offset)))) { // insufficient space?
-
+            capacity_t src_usage = source_.usage(src);
+            if (src_usage == 0) {                                        // no source data
+                D22_COUNT(rejected_empty_source);
+                continue;
+            }
+            if (src_usage > dst_avail) {                                 // insufficient space?
+                D22_COUNT(rejected_no_room);
                 continue;
             }
 
             // We must always move the entirety of a node's data, so
             // as a result of merging src and dst we could end up with more data
-            // than will fit in the destination (0,0) server
-            if ((src_server_ == source_->data_offset()) &&
-                ((source_->usage(src_server_) + source_->usage(offset)) >
-                 servers[0].capacity)) {
+            // than will fit in the goal server
+            if ((src == source_.data_offset()) &&
+                ((src_usage + source_.usage(dst)) > grid.capacity(move_graph_->goal()))) {
+                D22_COUNT(rejected_origin_overflow);
                 continue;
             }
 
             // all checks pass;  we can use this pair
+            D22_COUNT(edges_generated);
             return;
 
         }
-        dst_server_ = grid_neighbor::North;   // resume search at next source server
+        src_dir_ = grid_neighbor::North;      // resume search at next receiver
     }        
 
-    if (src_server_ >= servers.size()) {
-        // we have run out of valid moves
-        sentinel_ = true;
-    }
+    // we have run out of valid moves
+    sentinel_ = true;
 }
 
+template<typename Capacity>
 size_t
-move_graph_t::out_edge_iterator_t::dst_offset() const {
-    size_t stride = move_graph_->col_stride();
-    if ((dst_server_ == grid_neighbor::North) && ((src_server_ % stride) > 0)) {
-        return src_server_ - 1;
-    } else if ((dst_server_ == grid_neighbor::South) &&
-               ((src_server_ % stride) < (stride - 1))) {
-        return src_server_ + 1;
-    } else if ((dst_server_ == grid_neighbor::West) && (src_server_ >= stride)) {
-        return src_server_ - stride;
-    } else if ((dst_server_ == grid_neighbor::East) &&
-               ((src_server_ + stride) < move_graph_->servers().size())) {
-        return src_server_ + stride;
-    } else {
-        return move_graph_->servers().size();  // "invalid" sentinel
+basic_move_graph_t<Capacity>::out_edge_iterator_t::dst_server() const {
+    return source_.receivers()[receiver_idx_];
+}
+
+template<typename Capacity>
+size_t
+basic_move_graph_t<Capacity>::out_edge_iterator_t::src_server() const {
+    return move_graph_->neighbor(dst_server(), src_dir_);
+}
+
+template<typename Capacity>
+basic_server_state_t<Capacity>::basic_server_state_t()
+    : delta_filter_(0), original_data_location(0), hash_(0) {}
+
+template<typename Capacity>
+typename basic_server_state_t<Capacity>::receivers_t const &
+basic_server_state_t<Capacity>::receivers() const {
+    return *receivers_;
+}
+
+// Zobrist hashing support
+// A classic Zobrist table holds a random key for every (server, usage) combination, but
+// usages can take on any capacity_t value.  Instead we derive each key on demand by
+// running the combination through the splitmix64 finalizer, which behaves like a table
+// of random numbers without the storage.
+
+namespace {
+
+std::uint64_t
+zobrist_mix(std::uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+std::uint64_t
+zobrist_usage_key(size_t server, std::int32_t usage) {
+    return zobrist_mix((static_cast<std::uint64_t>(server) << 32) |
+                       static_cast<std::uint32_t>(usage));
+}
+
+std::uint64_t
+zobrist_location_key(size_t server) {
+    // a different "column" of the virtual table than any usage key
+    return zobrist_mix(~static_cast<std::uint64_t>(server));
+}
+
+}
+
+template<typename Capacity>
+std::uint64_t
+basic_server_state_t<Capacity>::full_hash() const {
+    std::uint64_t h = zobrist_location_key(original_data_location);
+    for (size_t i = 0; i < size(); ++i) {
+        h ^= zobrist_usage_key(i, usage(i));
     }
+    return h;
 }
 
-server_state_t::server_state_t() {}
+template<typename Capacity>
+std::uint64_t
+basic_server_state_t<Capacity>::hash() const {
+    return hash_;
+}
 
 // Utility function for producing a new state from a move
-server_state_t
-server_state_t::state_if_move(size_t src, size_t dst) const {
+template<typename Capacity>
+basic_server_state_t<Capacity>
+basic_server_state_t<Capacity>::state_if_move(size_t src, size_t dst,
+                                              basic_move_graph_t<Capacity> const& g) const {
     // turn the source -> dest move into a new usage state
-    server_state_t moved_state;
-    // make a deep copy of the usages
-    moved_state.usages = std::make_shared<std::vector<capacity_t>>(usages->begin(), usages->end());
+    basic_server_state_t moved_state;
+    moved_state.base_ = base_;                  // shared, not copied
     moved_state.original_data_location = original_data_location;
-    // now modify the usages to reflect the move
-    (*moved_state.usages)[dst] += (*moved_state.usages)[src];
-    (*moved_state.usages)[src] = 0;
+    moved_state.hash_ = hash_;
+
+    // only the src and dst entries change, so only their hash keys need replacing
+    capacity_t src_usage = usage(src);
+    capacity_t dst_usage = usage(dst);
+    moved_state.hash_ ^= zobrist_usage_key(src, src_usage) ^ zobrist_usage_key(dst, dst_usage);
+    dst_usage += src_usage;
+    src_usage = 0;
+    moved_state.hash_ ^= zobrist_usage_key(src, src_usage) ^ zobrist_usage_key(dst, dst_usage);
     if (src == moved_state.original_data_location) {
         // moving the target data
         moved_state.original_data_location = dst;
+        moved_state.hash_ ^= zobrist_location_key(src) ^ zobrist_location_key(dst);
+    }
+
+    // record the two changes in a copy of our delta list, keeping it sorted, with room
+    // for them so the copy is the only allocation
+    arena_allocator_t<void> alloc;
+    auto deltas = std::allocate_shared<deltas_t>(alloc, alloc);
+    deltas->reserve((deltas_ ? deltas_->size() : 0) + 2);
+    if (deltas_) {
+        deltas->assign(deltas_->begin(), deltas_->end());
+    }
+    auto set_usage = [&deltas](size_t server, capacity_t u) {
+        auto it = std::lower_bound(deltas->begin(), deltas->end(), server,
+                                   [](usage_delta_t const& d, size_t s) {
+                                       return d.server < s;
+                                   });
+        if ((it != deltas->end()) && (it->server == server)) {
+            it->usage = u;
+        } else {
+            deltas->insert(it, usage_delta_t{static_cast<std::uint32_t>(server), u});
+        }
+    };
+    set_usage(src, src_usage);
+    set_usage(dst, dst_usage);
+    D22_COUNT(state_allocations);
+    D22_COUNT_N(state_bytes, deltas->capacity() * sizeof(usage_delta_t));
+
+    // The source has become empty, so may now be a receiver, and the destination may
+    // no longer be one. If neither changes we can share our receiver list.
+    auto const & grid = g.grid();
+    bool src_receives = grid.capacity(src) >= g.receiver_threshold();
+    bool dst_receives = (grid.capacity(dst) - dst_usage) >= g.receiver_threshold();
+    auto src_it = std::lower_bound(receivers_->begin(), receivers_->end(), src);
+    auto dst_it = std::lower_bound(receivers_->begin(), receivers_->end(), dst);
+    bool src_listed = (src_it != receivers_->end()) && (*src_it == src);
+    bool dst_listed = (dst_it != receivers_->end()) && (*dst_it == dst);
+    if ((src_receives == src_listed) && (dst_receives == dst_listed)) {
+        moved_state.receivers_ = receivers_;
+    } else {
+        auto receivers = std::allocate_shared<receivers_t>(alloc, alloc);
+        receivers->reserve(receivers_->size() + 1);
+        for (auto r : *receivers_) {
+            if ((r != src) && (r != dst)) {
+                receivers->push_back(r);
+            }
+        }
+        for (size_t r : { src, dst }) {
+            if ((r == src) ? src_receives : dst_receives) {
+                receivers->insert(std::lower_bound(receivers->begin(), receivers->end(), r),
+                                  static_cast<std::uint32_t>(r));
+            }
+        }
+        D22_COUNT(state_allocations);
+        D22_COUNT_N(state_bytes, receivers->capacity() * sizeof(std::uint32_t));
+        moved_state.receivers_ = std::move(receivers);
+    }
+
+    // Once lookups and copies of the delta list start to cost about as much as the
+    // amortized cost of a new base, make one
+    size_t delta_limit = std::max<size_t>(8, std::sqrt(base_->size()));
+    if (deltas->size() > delta_limit) {
+        auto base = std::allocate_shared<base_t>(alloc, base_->begin(), base_->end(), alloc);
+        for (auto const& d : *deltas) {
+            (*base)[d.server] = d.usage;
+        }
+        D22_COUNT(state_allocations);
+        D22_COUNT_N(state_bytes, base->size() * sizeof(capacity_t));
+        moved_state.base_ = std::move(base);
+    } else {
+        for (auto const& d : *deltas) {
+            moved_state.delta_filter_ |= std::uint64_t(1) << (d.server % 64);
+        }
+        moved_state.deltas_ = std::move(deltas);
     }
     return moved_state;
 }
 
+// compare usages, taking advantage of any shared base
+template<typename Capacity>
+bool
+basic_server_state_t<Capacity>::same_usages(basic_server_state_t const& other) const {
+    if (base_ == other.base_) {
+        // only entries in one delta list or the other can differ
+        for (auto const * d : { deltas_.get(), other.deltas_.get() }) {
+            if (d) {
+                for (auto const& entry : *d) {
+                    if (usage(entry.server) != other.usage(entry.server)) {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+    if (size() != other.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < size(); ++i) {
+        if (usage(i) != other.usage(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename Capacity>
+bool
+basic_server_state_t<Capacity>::operator<(basic_server_state_t const& other) const {
+    // any strict weak ordering consistent with operator== will do, so lead with the hash
+    if (hash_ != other.hash_) {
+        return hash_ < other.hash_;
+    }
+    if (original_data_location != other.original_data_location) {
+        return original_data_location < other.original_data_location;
+    }
+    for (size_t i = 0; (i < size()) && (i < other.size()); ++i) {
+        if (usage(i) != other.usage(i)) {
+            return usage(i) < other.usage(i);
+        }
+    }
+    return size() < other.size();
+}
+
+template<typename Capacity>
 bool
-server_state_t::operator<(server_state_t const& other) const {
-    return (original_data_location < other.original_data_location) ||
-        ((original_data_location == other.original_data_location) &&
-         (*usages < *other.usages));
+basic_server_state_t<Capacity>::operator==(basic_server_state_t const& other) const {
+    // hashes are cheap to compare and almost always settle the question
+    return (hash_ == other.hash_) &&
+        (original_data_location == other.original_data_location) &&
+        same_usages(other);
 }
 
+template<typename Capacity>
 bool
-server_state_t::operator==(server_state_t const& other) const {
-    return (original_data_location == other.original_data_location) &&
-        (*usages == *(other.usages));
+basic_server_state_t<Capacity>::operator!=(basic_server_state_t const& other) const {
+    return !(*this == other);
 }
 
+template<typename Capacity>
 size_t
-server_state_t::data_offset() const {
+basic_server_state_t<Capacity>::data_offset() const {
     return original_data_location;
 }
 
-server_state_t::capacity_t
-server_state_t::usage(size_t offset) const {
-    return (*usages)[offset];
+template<typename Capacity>
+typename basic_server_state_t<Capacity>::capacity_t
+basic_server_state_t<Capacity>::usage(size_t offset) const {
+    // most servers are unchanged from the base, which the filter usually reveals
+    if (delta_filter_ & (std::uint64_t(1) << (offset % 64))) {
+        auto it = std::lower_bound(deltas_->begin(), deltas_->end(), offset,
+                                   [](usage_delta_t const& d, size_t s) {
+                                       return d.server < s;
+                                   });
+        if ((it != deltas_->end()) && (it->server == offset)) {
+            return it->usage;
+        }
+    }
+    return (*base_)[offset];
+}
+
+template<typename Capacity>
+size_t
+basic_server_state_t<Capacity>::size() const {
+    return base_ ? base_->size() : 0;
 }
 
+template<typename Capacity>
 std::ostream&
-operator<<(std::ostream & os, server_state_t const& s) {
+operator<<(std::ostream & os, basic_server_state_t<Capacity> const& s) {
     os << "original data at " << s.data_offset() << "\n";
     os << "capacities: ";
-    std::copy(s.usages->begin(), s.usages->end(),
-              std::ostream_iterator<int>(os, ", "));
+    for (size_t i = 0; i < s.size(); ++i) {
+        os << s.usage(i) << ", ";
+    }
     return os;
 }
+
+template struct basic_server_state_t<std::int16_t>;
+template struct basic_server_state_t<std::int32_t>;
+template struct basic_move_graph_t<std::int16_t>;
+template struct basic_move_graph_t<std::int32_t>;
+
+#define D22_INSTANTIATE_GRAPH_FUNCTIONS(Capacity)                                      \
+    template basic_server_state_t<Capacity>                                            \
+    source(std::pair<basic_server_state_t<Capacity>, basic_server_state_t<Capacity>> const&, \
+           basic_move_graph_t<Capacity> const&);                                       \
+    template basic_server_state_t<Capacity>                                            \
+    target(std::pair<basic_server_state_t<Capacity>, basic_server_state_t<Capacity>> const&, \
+           basic_move_graph_t<Capacity> const&);                                       \
+    template std::pair<basic_move_graph_t<Capacity>::out_edge_iterator_t,              \
+                       basic_move_graph_t<Capacity>::out_edge_iterator_t>              \
+    out_edges(basic_server_state_t<Capacity> const&, basic_move_graph_t<Capacity> const&); \
+    template size_t                                                                    \
+    out_degree(basic_server_state_t<Capacity> const&, basic_move_graph_t<Capacity> const&); \
+    template std::ostream&                                                             \
+    operator<<(std::ostream &, basic_server_state_t<Capacity> const&);
+
+D22_INSTANTIATE_GRAPH_FUNCTIONS(std::int16_t)
+D22_INSTANTIATE_GRAPH_FUNCTIONS(std::int32_t)
@@ -4,55 +4,111 @@
 #include <boost/graph/graph_utility.hpp>
 #include <boost/property_map/property_map.hpp>
 
-struct server_t {
-    using capacity_t = std::int16_t;
-
-    int        x;
-    int        y;
-    capacity_t capacity;
-};
-
-enum class grid_neighbor { North, South, East, West, Invalid };
-grid_neighbor& operator++(grid_neighbor&);
-
-struct server_state_t {
-    using capacity_t = server_t::capacity_t;
-
-    server_state_t();
-
+#include "arena.h"
+#include "grid.h"
+#include "moves.h"
+
+// How a server can participate in moves, given the initial usages
+// Walls hold too much data to ever move, or to ever receive data. Empty servers are
+// the "holes" that everything else slides into.
+enum class server_class { Wall, Movable, Empty };
+
+template<typename Capacity> struct basic_move_graph_t;
+
+// Search states share as much data as possible. Usages are stored as an immutable
+// "base" array, shared by many states, plus a short sorted list of the servers whose
+// usage differs from it. Each move adds at most two entries to that list, and once it
+// grows past about sqrt(N) entries the state gets a fresh base of its own.
+// Each state also indexes its "receivers": the servers with enough free space to accept
+// the smallest piece of data there is. Only moves into those can be legal.
+// All three arrays come from the current search arena, if there is one.
+template<typename Capacity>
+struct basic_server_state_t {
+    using capacity_t = Capacity;
+
+    basic_server_state_t();
+
+    // normally created through basic_move_graph_t::initial_state()
     template<typename UsageIt>
-    server_state_t(size_t target_data_offset,
-                   UsageIt ubegin, UsageIt uend) :
-        usages(std::make_shared<std::vector<capacity_t>>(ubegin, uend)),
-        original_data_location(target_data_offset) {}
+    basic_server_state_t(size_t target_data_offset,
+                   UsageIt ubegin, UsageIt uend,
+                   std::vector<std::uint32_t> receivers) :
+        base_(std::allocate_shared<base_t>(arena_allocator_t<base_t>(), ubegin, uend,
+                                           arena_allocator_t<capacity_t>())),
+        delta_filter_(0),
+        receivers_(std::allocate_shared<receivers_t>(arena_allocator_t<receivers_t>(),
+                                                     receivers.begin(), receivers.end(),
+                                                     arena_allocator_t<std::uint32_t>())),
+        original_data_location(target_data_offset),
+        hash_(full_hash()) {}
+
+    using receivers_t = std::vector<std::uint32_t, arena_allocator_t<std::uint32_t>>;
 
     capacity_t usage(size_t idx) const;
+    size_t     size() const;
+    receivers_t const & receivers() const;   // sorted
 
-    bool operator<(server_state_t const& other) const;
-    bool operator==(server_state_t const& other) const;
-    bool operator!=(server_state_t const& other) const;
+    bool operator<(basic_server_state_t const& other) const;
+    bool operator==(basic_server_state_t const& other) const;
+    bool operator!=(basic_server_state_t const& other) const;
     size_t data_offset() const;
+    std::uint64_t hash() const;
 
-    server_state_t state_if_move(size_t, size_t) const;
-
-    // helper for vertex printing
-    friend std::ostream& operator<<(std::ostream &, server_state_t const&);
+    // the state after moving all data from src to dst
+    basic_server_state_t state_if_move(size_t src, size_t dst,
+                                       basic_move_graph_t<Capacity> const& g) const;
 
 private:
-    std::shared_ptr<std::vector<capacity_t>> usages; // original usage per server
+    struct usage_delta_t {
+        std::uint32_t server;
+        capacity_t    usage;
+    };
+    using base_t   = std::vector<capacity_t, arena_allocator_t<capacity_t>>;
+    using deltas_t = std::vector<usage_delta_t, arena_allocator_t<usage_delta_t>>;
+
+    std::shared_ptr<base_t const>   base_;           // usages, possibly shared with other states
+    std::shared_ptr<deltas_t const> deltas_;         // changes from base_, sorted by server
+    std::uint64_t                   delta_filter_;   // bit (server % 64) set for each delta
+    std::shared_ptr<receivers_t const> receivers_;
     size_t                  original_data_location;  // where desired data is
+    std::uint64_t           hash_;                   // Zobrist hash of usages and data location
+
+    std::uint64_t full_hash() const;
+    bool same_usages(basic_server_state_t const& other) const;
 };
 
+// helper for vertex printing
+template<typename Capacity>
+std::ostream& operator<<(std::ostream &, basic_server_state_t<Capacity> const&);
+
+// allow states to be used as keys in unordered containers
+namespace std {
+
+template<typename Capacity>
+struct hash<basic_server_state_t<Capacity>> {
+    size_t operator()(basic_server_state_t<Capacity> const& s) const {
+        return s.hash();
+    }
+};
+
+}
+
 // there is essentially no edge property because it either exists or does not exist
 // and all edges are weight 1 - a constant property map may be appropriate here
 
 // for astar_search_no_init (appropriate for implicit graphs) we need to model IncidenceGraph
 
-struct move_graph_t {
-    using vertex_t = server_state_t;
-    using edge_t   = std::pair<vertex_t, vertex_t>;
+template<typename Capacity>
+struct basic_move_graph_t {
+    using capacity_t = Capacity;
+    using grid_type  = basic_grid_t<Capacity>;
+    using vertex_t   = basic_server_state_t<Capacity>;
+    using edge_t     = std::pair<vertex_t, vertex_t>;
 
-    move_graph_t(std::vector<server_t> servers);
+    // the target data starts in the upper right corner and must reach the origin
+    explicit basic_move_graph_t(grid_type grid);
+    // ... or starts and finishes on the given servers
+    basic_move_graph_t(grid_type grid, size_t data_start, size_t goal);
 
     struct out_edge_iterator_t
         : boost::iterator_facade<out_edge_iterator_t,
@@ -63,8 +119,8 @@ struct move_graph_t {
         // default constructor for "end of edges"
         out_edge_iterator_t();
         // another for beginning the range
-        out_edge_iterator_t(move_graph_t const *      g,
-                            std::shared_ptr<vertex_t> source);
+        out_edge_iterator_t(basic_move_graph_t const * g,
+                            vertex_t const &     source);
 
         // requirements for iterator_facade
         edge_t dereference() const;
@@ -76,40 +132,81 @@ struct move_graph_t {
     private:
 
         void ensure_valid();
-        size_t dst_offset() const;
+        size_t dst_server() const;
+        size_t src_server() const;
 
-        move_graph_t const *      move_graph_;
-        std::shared_ptr<vertex_t> source_;
+        // Moves are enumerated by destination - each receiver of the source state -
+        // and then by the direction the data comes from
+        basic_move_graph_t const * move_graph_;
+        vertex_t                  source_;       // copying a state does not allocate
         bool                      sentinel_;
-        size_t                    src_server_;
-        grid_neighbor             dst_server_;
+        size_t                    receiver_idx_;
+        grid_neighbor             src_dir_;
     };
 
-    std::vector<server_t> const & servers()    const;
-    size_t                        col_stride() const;
-    size_t                        ur_corner()  const;
+    grid_type const &             grid()       const;
+    size_t                        data_start() const;   // where the target data begins
+    size_t                        goal()       const;   // and where it has to go
+
+    // the starting state, with the target data on data_start()
+    vertex_t                      initial_state() const;
+
+    // the move that takes one state to the next along a path
+    move_t                        move(vertex_t const& from, vertex_t const& to) const;
+
+    // Fixed-size encodings of states, for searches that keep them on disk: the target
+    // data location, then every usage. Equal states have equal encodings.
+    size_t                        state_bytes() const;
+    void                          encode(vertex_t const& v, unsigned char * out) const;
+    vertex_t                      decode(unsigned char const * in) const;
+
+    // the smallest nonzero usage at the start. Data only ever merges, so no
+    // server with less free space than this can ever receive a move
+    capacity_t                    receiver_threshold() const;
+
+    // offset of the server adjacent in the given direction, or grid().size() if none
+    size_t                        neighbor(size_t offset, grid_neighbor dir) const;
+
+    // Classification of servers for the reduced (hole + data) state space
+    // If the initial usages are such that data never merges, walls never take part in
+    // moves, and any movable data fits in any hole, the only things that change are the
+    // hole and target data positions. abstraction_sound() reports whether that holds;
+    // if not, abstraction_problem() explains why.
+    server_class                  classification(size_t offset) const;
+    std::vector<size_t> const &   holes()               const;
+    bool                          abstraction_sound()   const;
+    std::string const &           abstraction_problem() const;
 
 private:
-    std::vector<server_t> const servers_;
-    size_t                      ur_corner_;
-    size_t                      col_stride_;
+    void classify();
+
+    grid_type const             grid_;
+    size_t                      data_start_;
+    size_t                      goal_;
+    capacity_t                  receiver_threshold_;
+    std::vector<server_class>   classes_;
+    std::vector<size_t>         holes_;
+    std::string                 abstraction_problem_;   // empty if sound
 };
 
+using server_state_t = basic_server_state_t<std::int16_t>;
+using move_graph_t   = basic_move_graph_t<std::int16_t>;
+
 // Concept type requirements
 namespace boost {
 
-template<>
-struct graph_traits<move_graph_t> {
+template<typename Capacity>
+struct graph_traits<basic_move_graph_t<Capacity>> {
     // for Graph
-    using vertex_descriptor      = move_graph_t::vertex_t;
-    using edge_descriptor        = move_graph_t::edge_t;
+    using vertex_descriptor      = typename basic_move_graph_t<Capacity>::vertex_t;
+    using edge_descriptor        = typename basic_move_graph_t<Capacity>::edge_t;
     using directed_category      = directed_tag;
     using edge_parallel_category = disallow_parallel_edge_tag;
 
 
     // for IncidenceGraph
     using traversal_category = incidence_graph_tag;
-    using out_edge_iterator  = move_graph_t::out_edge_iterator_t;
+    using out_edge_iterator  = typename basic_move_graph_t<Capacity>::out_edge_iterator_t;
     using degree_size_type   = size_t;
 
 };
@@ -118,13 +215,22 @@ struct graph_traits<move_graph_t> {
 }
 
 // Free function requirements for IncidenceGraph
-move_graph_t::vertex_t source(move_graph_t::edge_t const&, move_graph_t const&);
-move_graph_t::vertex_t target(move_graph_t::edge_t const&, move_graph_t const&);
-
-std::pair<move_graph_t::out_edge_iterator_t, move_graph_t::out_edge_iterator_t>
-out_edges(move_graph_t::vertex_t const&, move_graph_t const&);
-
+template<typename Capacity>
+basic_server_state_t<Capacity> source(std::pair<basic_server_state_t<Capacity>,
+                                                basic_server_state_t<Capacity>> const&,
+                                      basic_move_graph_t<Capacity> const&);
+template<typename Capacity>
+basic_server_state_t<Capacity> target(std::pair<basic_server_state_t<Capacity>,
+                                                basic_server_state_t<Capacity>> const&,
+                                      basic_move_graph_t<Capacity> const&);
+
+template<typename Capacity>
+std::pair<typename basic_move_graph_t<Capacity>::out_edge_iterator_t,
+          typename basic_move_graph_t<Capacity>::out_edge_iterator_t>
+out_edges(basic_server_state_t<Capacity> const&, basic_move_graph_t<Capacity> const&);
+
+template<typename Capacity>
 size_t
-out_degree(move_graph_t::vertex_t const&, move_graph_t const&);
+out_degree(basic_server_state_t<Capacity> const&, basic_move_graph_t<Capacity> const&);
 
 #endif // GRAPH_H
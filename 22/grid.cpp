@@ -0,0 +1,596 @@
+// Structure-of-arrays server grid and move kernels for Advent of Code, Day 22
+
+#include "grid.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+grid_neighbor&
+operator++(grid_neighbor& gn) {
+    if (gn == grid_neighbor::North) {
+        gn = grid_neighbor::South;
+    } else if (gn == grid_neighbor::South) {
+        gn = grid_neighbor::East;
+    } else if (gn == grid_neighbor::East) {
+        gn = grid_neighbor::West;
+    } else {
+        gn = grid_neighbor::Invalid;
+    }
+    return gn;
+}
+
+unsigned
+capacity_bits(std::vector<server_t> const& servers) {
+    for (auto const& s : servers) {
+        if (s.capacity > std::numeric_limits<std::int16_t>::max()) {
+            return 32;
+        }
+    }
+    return 16;
+}
+
+namespace {
+
+constexpr size_t lane_alignment = 64;
+
+size_t
+round_up(size_t n, size_t m) {
+    return (n + m - 1) / m * m;
+}
+
+// bit i set iff usage[i] != 0 and usage[i] <= avail[i]; defined with the other kernels
+void legal_move_mask(std::int16_t const * usage, std::int16_t const * avail,
+                     size_t count, std::uint64_t * mask);
+void legal_move_mask(std::int32_t const * usage, std::int32_t const * avail,
+                     size_t count, std::uint64_t * mask);
+
+}
+
+template<typename Capacity>
+basic_grid_t<Capacity>::basic_grid_t(std::vector<server_t> const& servers,
+                                     std::vector<server_t::capacity_t> const& usages) {
+    using namespace std;
+
+    if (servers.empty() || (servers.size() != usages.size())) {
+        throw invalid_argument("grid needs one usage for each of at least one server");
+    }
+    int max_x = 0, max_y = 0;
+    for (auto const& s : servers) {
+        if ((s.x < 0) || (s.y < 0)) {
+            throw invalid_argument("negative server coordinates");
+        }
+        max_x = max(max_x, s.x);
+        max_y = max(max_y, s.y);
+    }
+    width_ = max_x + 1;
+    height_ = max_y + 1;
+    size_ = width_ * height_;
+    if (size_ != servers.size()) {
+        throw invalid_argument("servers do not form a complete " + to_string(width_) + "x" +
+                               to_string(height_) + " grid");
+    }
+    padded_size_ = round_up(size_, 64);
+
+    // carve all the lanes out of one aligned block
+    size_t total = storage_bytes();
+    char * block = static_cast<char *>(aligned_alloc(lane_alignment, total));
+    if (!block) {
+        throw bad_alloc();
+    }
+    storage_ = shared_ptr<void const>(block, free);
+    memset(block, 0, total);
+    bind(block);
+
+    vector<bool> seen(size_);
+    for (size_t i = 0; i < servers.size(); ++i) {
+        size_t off = offset(servers[i].x, servers[i].y);
+        if (seen[off]) {
+            throw invalid_argument("duplicate server x" + to_string(servers[i].x) +
+                                   "-y" + to_string(servers[i].y));
+        }
+        seen[off] = true;
+        if ((usages[i] < 0) || (usages[i] > servers[i].capacity)) {
+            throw invalid_argument("usage out of range for server x" +
+                                   to_string(servers[i].x) + "-y" + to_string(servers[i].y));
+        }
+        if (servers[i].capacity > numeric_limits<capacity_t>::max()) {
+            throw invalid_argument("capacity of server x" + to_string(servers[i].x) + "-y" +
+                                   to_string(servers[i].y) + " needs wider lanes");
+        }
+        capacity_[off] = servers[i].capacity;
+        usage_[off] = usages[i];
+        avail_[off] = servers[i].capacity - usages[i];
+        x_[off] = servers[i].x;
+        y_[off] = servers[i].y;
+    }
+    // padding can neither give nor receive data
+    fill(avail_ + size_, avail_ + padded_size_, capacity_t(-1));
+    fill(capacity_ + size_, capacity_ + padded_size_, capacity_t(-1));
+
+    for (size_t i = 0; i < size_; ++i) {
+        size_t y = y_[i];
+        neighbors_[static_cast<size_t>(grid_neighbor::North)][i] =
+            (y > 0) ? (i - 1) : size_;
+        neighbors_[static_cast<size_t>(grid_neighbor::South)][i] =
+            (y + 1 < height_) ? (i + 1) : size_;
+        neighbors_[static_cast<size_t>(grid_neighbor::East)][i] =
+            (i + height_ < size_) ? (i + height_) : size_;
+        neighbors_[static_cast<size_t>(grid_neighbor::West)][i] =
+            (i >= height_) ? (i - height_) : size_;
+    }
+
+    // A server is a wall unless its data would fit in some neighbor were that neighbor
+    // empty - i.e. a legal move with the capacity lane standing in for free space
+    vector<uint64_t> movable(padded_size_ / 64);
+    vector<uint64_t> column((height_ + 63) / 64);
+    for (size_t x = 0; x < width_; ++x) {
+        for (grid_neighbor dir = grid_neighbor::North; dir <= grid_neighbor::West; ++dir) {
+            column_legal_moves(x, dir, usage_, capacity_, column.data());
+            for (size_t y = 0; y < height_; ++y) {
+                if (column[y / 64] & (uint64_t(1) << (y % 64))) {
+                    size_t off = x * height_ + y;
+                    movable[off / 64] |= uint64_t(1) << (off % 64);
+                }
+            }
+        }
+    }
+    for (size_t i = 0; i < size_; ++i) {
+        bool can_move = movable[i / 64] & (uint64_t(1) << (i % 64));
+        if ((usage_[i] != 0) && !can_move) {
+            walls_[i / 64] |= uint64_t(1) << (i % 64);
+        }
+    }
+}
+
+template<typename Capacity>
+basic_grid_t<Capacity>::basic_grid_t(size_t width, size_t height,
+                                     std::shared_ptr<void const> storage, size_t bytes)
+    : width_(width), height_(height), size_(width * height), padded_size_(round_up(size_, 64)) {
+    if ((width == 0) || (height == 0) || (bytes != storage_bytes())) {
+        throw std::invalid_argument("grid storage does not match its dimensions");
+    }
+    if (reinterpret_cast<std::uintptr_t>(storage.get()) % lane_alignment) {
+        throw std::invalid_argument("grid storage is not aligned");
+    }
+    storage_ = std::move(storage);
+    // the lanes are never written after construction
+    bind(const_cast<char *>(static_cast<char const *>(storage_.get())));
+}
+
+template<typename Capacity>
+size_t
+basic_grid_t<Capacity>::storage_bytes() const {
+    using namespace std;
+    size_t cap_bytes = round_up(padded_size_ * sizeof(capacity_t), lane_alignment);
+    size_t coord_bytes = round_up(size_ * sizeof(int32_t), lane_alignment);
+    size_t nbr_bytes = round_up(size_ * sizeof(uint32_t), lane_alignment);
+    size_t wall_bytes = round_up(padded_size_ / 64 * sizeof(uint64_t), lane_alignment);
+    return 3 * cap_bytes + 2 * coord_bytes + 4 * nbr_bytes + wall_bytes;
+}
+
+template<typename Capacity>
+void const *
+basic_grid_t<Capacity>::storage() const {
+    return storage_.get();
+}
+
+// point each lane into its place in the block
+template<typename Capacity>
+void
+basic_grid_t<Capacity>::bind(char * block) {
+    using namespace std;
+    size_t cap_bytes = round_up(padded_size_ * sizeof(capacity_t), lane_alignment);
+    size_t coord_bytes = round_up(size_ * sizeof(int32_t), lane_alignment);
+    size_t nbr_bytes = round_up(size_ * sizeof(uint32_t), lane_alignment);
+
+    capacity_ = reinterpret_cast<capacity_t *>(block);
+    usage_    = reinterpret_cast<capacity_t *>(block + cap_bytes);
+    avail_    = reinterpret_cast<capacity_t *>(block + 2 * cap_bytes);
+    x_        = reinterpret_cast<int32_t *>(block + 3 * cap_bytes);
+    y_        = reinterpret_cast<int32_t *>(block + 3 * cap_bytes + coord_bytes);
+    for (size_t d = 0; d < 4; ++d) {
+        neighbors_[d] = reinterpret_cast<uint32_t *>(block + 3 * cap_bytes + 2 * coord_bytes +
+                                                     d * nbr_bytes);
+    }
+    walls_ = reinterpret_cast<uint64_t *>(block + 3 * cap_bytes + 2 * coord_bytes +
+                                          4 * nbr_bytes);
+}
+
+template<typename Capacity>
+size_t
+basic_grid_t<Capacity>::size() const {
+    return size_;
+}
+
+template<typename Capacity>
+size_t
+basic_grid_t<Capacity>::width() const {
+    return width_;
+}
+
+template<typename Capacity>
+size_t
+basic_grid_t<Capacity>::height() const {
+    return height_;
+}
+
+template<typename Capacity>
+size_t
+basic_grid_t<Capacity>::offset(int x, int y) const {
+    return x * height_ + y;
+}
+
+template<typename Capacity>
+int
+basic_grid_t<Capacity>::x(size_t offset) const {
+    return x_[offset];
+}
+
+template<typename Capacity>
+int
+basic_grid_t<Capacity>::y(size_t offset) const {
+    return y_[offset];
+}
+
+template<typename Capacity>
+typename basic_grid_t<Capacity>::capacity_t
+basic_grid_t<Capacity>::capacity(size_t offset) const {
+    return capacity_[offset];
+}
+
+template<typename Capacity>
+typename basic_grid_t<Capacity>::capacity_t
+basic_grid_t<Capacity>::usage(size_t offset) const {
+    return usage_[offset];
+}
+
+template<typename Capacity>
+typename basic_grid_t<Capacity>::capacity_t
+basic_grid_t<Capacity>::avail(size_t offset) const {
+    return avail_[offset];
+}
+
+template<typename Capacity>
+size_t
+basic_grid_t<Capacity>::neighbor(size_t offset, grid_neighbor dir) const {
+    return neighbors_[static_cast<size_t>(dir)][offset];
+}
+
+template<typename Capacity>
+bool
+basic_grid_t<Capacity>::wall(size_t offset) const {
+    return walls_[offset / 64] & (std::uint64_t(1) << (offset % 64));
+}
+
+template<typename Capacity>
+std::uint64_t const *
+basic_grid_t<Capacity>::wall_bits() const {
+    return walls_;
+}
+
+template<typename Capacity>
+typename basic_grid_t<Capacity>::capacity_t const *
+basic_grid_t<Capacity>::capacities() const {
+    return capacity_;
+}
+
+template<typename Capacity>
+typename basic_grid_t<Capacity>::capacity_t const *
+basic_grid_t<Capacity>::usages() const {
+    return usage_;
+}
+
+template<typename Capacity>
+typename basic_grid_t<Capacity>::capacity_t const *
+basic_grid_t<Capacity>::avails() const {
+    return avail_;
+}
+
+template<typename Capacity>
+void
+basic_grid_t<Capacity>::column_legal_moves(size_t x, grid_neighbor dir,
+                           capacity_t const * usage, capacity_t const * avail,
+                           std::uint64_t * mask) const {
+    size_t words = (height_ + 63) / 64;
+    std::fill(mask, mask + words, 0);
+    size_t begin = x * height_;
+
+    switch (dir) {
+    case grid_neighbor::North:
+        // sources y = 1.. move into y - 1; result must be shifted up one bit
+        if (height_ > 1) {
+            std::vector<std::uint64_t> shifted(words);
+            legal_move_mask(usage + begin + 1, avail + begin, height_ - 1, shifted.data());
+            for (size_t w = 0; w < words; ++w) {
+                mask[w] = (shifted[w] << 1) | ((w > 0) ? (shifted[w - 1] >> 63) : 0);
+            }
+        }
+        break;
+    case grid_neighbor::South:
+        // sources y = 0..height-2 move into y + 1
+        if (height_ > 1) {
+            legal_move_mask(usage + begin, avail + begin + 1, height_ - 1, mask);
+        }
+        break;
+    case grid_neighbor::East:
+        if (x + 1 < width_) {
+            legal_move_mask(usage + begin, avail + begin + height_, height_, mask);
+        }
+        break;
+    case grid_neighbor::West:
+        if (x > 0) {
+            legal_move_mask(usage + begin, avail + begin - height_, height_, mask);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+template struct basic_grid_t<std::int16_t>;
+template struct basic_grid_t<std::int32_t>;
+
+// Kernels
+
+namespace {
+
+template<typename Capacity>
+void
+legal_move_mask_scalar(Capacity const * usage, Capacity const * avail,
+                       size_t begin, size_t count, std::uint64_t * mask) {
+    for (size_t i = begin; i < count; ++i) {
+        if ((usage[i] != 0) && (usage[i] <= avail[i])) {
+            mask[i / 64] |= std::uint64_t(1) << (i % 64);
+        }
+    }
+}
+
+template<typename Capacity>
+void
+at_least_mask_scalar(Capacity const * values, size_t begin, size_t count,
+                     Capacity threshold, std::uint64_t * mask) {
+    for (size_t i = begin; i < count; ++i) {
+        if (values[i] >= threshold) {
+            mask[i / 64] |= std::uint64_t(1) << (i % 64);
+        }
+    }
+}
+
+}
+
+#if defined(__AVX2__)
+
+// 16 lanes of int16 or 8 of int32 per step. int16 comparison results are packed to
+// bytes to get one bit each; int32 results give theirs through the float sign bits.
+namespace {
+
+inline std::uint64_t
+lane_mask(__m256i lanes, std::int16_t) {
+    __m128i packed = _mm_packs_epi16(_mm256_castsi256_si128(lanes),
+                                     _mm256_extracti128_si256(lanes, 1));
+    return static_cast<std::uint16_t>(_mm_movemask_epi8(packed));
+}
+
+inline std::uint64_t
+lane_mask(__m256i lanes, std::int32_t) {
+    return static_cast<std::uint8_t>(_mm256_movemask_ps(_mm256_castsi256_ps(lanes)));
+}
+
+inline __m256i cmpeq(__m256i a, __m256i b, std::int16_t) { return _mm256_cmpeq_epi16(a, b); }
+inline __m256i cmpeq(__m256i a, __m256i b, std::int32_t) { return _mm256_cmpeq_epi32(a, b); }
+inline __m256i cmpgt(__m256i a, __m256i b, std::int16_t) { return _mm256_cmpgt_epi16(a, b); }
+inline __m256i cmpgt(__m256i a, __m256i b, std::int32_t) { return _mm256_cmpgt_epi32(a, b); }
+inline __m256i splat(std::int16_t v) { return _mm256_set1_epi16(v); }
+inline __m256i splat(std::int32_t v) { return _mm256_set1_epi32(v); }
+
+template<typename Capacity>
+void
+legal_move_mask_simd(Capacity const * usage, Capacity const * avail,
+                     size_t count, std::uint64_t * mask) {
+    constexpr size_t simd_width = 32 / sizeof(Capacity);
+    constexpr std::uint64_t all = (std::uint64_t(1) << simd_width) - 1;
+    std::fill(mask, mask + (count + 63) / 64, 0);
+    __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + simd_width <= count; i += simd_width) {
+        __m256i u = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(usage + i));
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(avail + i));
+        // illegal if no data, or more data than room
+        __m256i bad = _mm256_or_si256(cmpeq(u, zero, Capacity()), cmpgt(u, a, Capacity()));
+        std::uint64_t bits = ~lane_mask(bad, Capacity()) & all;
+        mask[i / 64] |= bits << (i % 64);
+    }
+    legal_move_mask_scalar(usage, avail, i, count, mask);
+}
+
+template<typename Capacity>
+void
+at_least_mask_simd(Capacity const * values, size_t count,
+                   Capacity threshold, std::uint64_t * mask) {
+    constexpr size_t simd_width = 32 / sizeof(Capacity);
+    constexpr std::uint64_t all = (std::uint64_t(1) << simd_width) - 1;
+    std::fill(mask, mask + (count + 63) / 64, 0);
+    __m256i t = splat(threshold);
+    size_t i = 0;
+    for (; i + simd_width <= count; i += simd_width) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(values + i));
+        std::uint64_t bits = ~lane_mask(cmpgt(t, v, Capacity()), Capacity()) & all;
+        mask[i / 64] |= bits << (i % 64);
+    }
+    at_least_mask_scalar(values, i, count, threshold, mask);
+}
+
+}
+
+namespace {
+char const * const vector_kernel_name = "avx2";
+}
+
+#elif defined(__SSE2__)
+
+// 8 lanes of int16 or 4 of int32 per step
+namespace {
+
+inline std::uint64_t
+lane_mask(__m128i lanes, std::int16_t) {
+    return static_cast<std::uint8_t>(_mm_movemask_epi8(_mm_packs_epi16(lanes,
+                                                                       _mm_setzero_si128())));
+}
+
+inline std::uint64_t
+lane_mask(__m128i lanes, std::int32_t) {
+    return static_cast<std::uint8_t>(_mm_movemask_ps(_mm_castsi128_ps(lanes)));
+}
+
+inline __m128i cmpeq(__m128i a, __m128i b, std::int16_t) { return _mm_cmpeq_epi16(a, b); }
+inline __m128i cmpeq(__m128i a, __m128i b, std::int32_t) { return _mm_cmpeq_epi32(a, b); }
+inline __m128i cmpgt(__m128i a, __m128i b, std::int16_t) { return _mm_cmpgt_epi16(a, b); }
+inline __m128i cmpgt(__m128i a, __m128i b, std::int32_t) { return _mm_cmpgt_epi32(a, b); }
+inline __m128i splat(std::int16_t v) { return _mm_set1_epi16(v); }
+inline __m128i splat(std::int32_t v) { return _mm_set1_epi32(v); }
+
+template<typename Capacity>
+void
+legal_move_mask_simd(Capacity const * usage, Capacity const * avail,
+                     size_t count, std::uint64_t * mask) {
+    constexpr size_t simd_width = 16 / sizeof(Capacity);
+    constexpr std::uint64_t all = (std::uint64_t(1) << simd_width) - 1;
+    std::fill(mask, mask + (count + 63) / 64, 0);
+    __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + simd_width <= count; i += simd_width) {
+        __m128i u = _mm_loadu_si128(reinterpret_cast<__m128i const *>(usage + i));
+        __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i const *>(avail + i));
+        __m128i bad = _mm_or_si128(cmpeq(u, zero, Capacity()), cmpgt(u, a, Capacity()));
+        std::uint64_t bits = ~lane_mask(bad, Capacity()) & all;
+        mask[i / 64] |= bits << (i % 64);
+    }
+    legal_move_mask_scalar(usage, avail, i, count, mask);
+}
+
+template<typename Capacity>
+void
+at_least_mask_simd(Capacity const * values, size_t count,
+                   Capacity threshold, std::uint64_t * mask) {
+    constexpr size_t simd_width = 16 / sizeof(Capacity);
+    constexpr std::uint64_t all = (std::uint64_t(1) << simd_width) - 1;
+    std::fill(mask, mask + (count + 63) / 64, 0);
+    __m128i t = splat(threshold);
+    size_t i = 0;
+    for (; i + simd_width <= count; i += simd_width) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(values + i));
+        std::uint64_t bits = ~lane_mask(cmpgt(t, v, Capacity()), Capacity()) & all;
+        mask[i / 64] |= bits << (i % 64);
+    }
+    at_least_mask_scalar(values, i, count, threshold, mask);
+}
+
+}
+
+namespace {
+char const * const vector_kernel_name = "sse2";
+}
+
+#else
+
+namespace {
+
+template<typename Capacity>
+void
+legal_move_mask_simd(Capacity const * usage, Capacity const * avail,
+                     size_t count, std::uint64_t * mask) {
+    std::fill(mask, mask + (count + 63) / 64, 0);
+    legal_move_mask_scalar(usage, avail, 0, count, mask);
+}
+
+template<typename Capacity>
+void
+at_least_mask_simd(Capacity const * values, size_t count,
+                   Capacity threshold, std::uint64_t * mask) {
+    std::fill(mask, mask + (count + 63) / 64, 0);
+    at_least_mask_scalar(values, 0, count, threshold, mask);
+}
+
+}
+
+namespace {
+char const * const vector_kernel_name = "scalar";
+}
+
+#endif
+
+namespace {
+
+bool vector_kernels = true;
+
+template<typename Capacity>
+void
+legal_move_mask_any(Capacity const * usage, Capacity const * avail,
+                    size_t count, std::uint64_t * mask) {
+    if (vector_kernels) {
+        legal_move_mask_simd(usage, avail, count, mask);
+    } else {
+        std::fill(mask, mask + (count + 63) / 64, 0);
+        legal_move_mask_scalar(usage, avail, 0, count, mask);
+    }
+}
+
+template<typename Capacity>
+void
+at_least_mask_any(Capacity const * values, size_t count,
+                  Capacity threshold, std::uint64_t * mask) {
+    if (vector_kernels) {
+        at_least_mask_simd(values, count, threshold, mask);
+    } else {
+        std::fill(mask, mask + (count + 63) / 64, 0);
+        at_least_mask_scalar(values, 0, count, threshold, mask);
+    }
+}
+
+}
+
+void
+use_vector_kernels(bool on) {
+    vector_kernels = on;
+}
+
+char const *
+grid_kernel_name() {
+    return vector_kernels ? vector_kernel_name : "scalar";
+}
+
+namespace {
+
+void
+legal_move_mask(std::int16_t const * usage, std::int16_t const * avail,
+                size_t count, std::uint64_t * mask) {
+    legal_move_mask_any(usage, avail, count, mask);
+}
+
+void
+legal_move_mask(std::int32_t const * usage, std::int32_t const * avail,
+                size_t count, std::uint64_t * mask) {
+    legal_move_mask_any(usage, avail, count, mask);
+}
+
+}
+
+void
+at_least_mask(std::int16_t const * values, size_t count,
+              std::int16_t threshold, std::uint64_t * mask) {
+    at_least_mask_any(values, count, threshold, mask);
+}
+
+void
+at_least_mask(std::int32_t const * values, size_t count,
+              std::int32_t threshold, std::uint64_t * mask) {
+    at_least_mask_any(values, count, threshold, mask);
+}
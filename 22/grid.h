@@ -0,0 +1,124 @@
+#ifndef GRID_H
+#define GRID_H
+
+// Structure-of-arrays representation of the server grid, plus vectorized kernels
+// for scanning its lanes
+// The grid, and everything built on it, is a template on the type of its capacity and
+// usage lanes. 16 bits covers the puzzle and keeps twice as many servers per vector
+// and per cache line; grids with larger capacities use 32. capacity_bits() says which
+// a loaded grid needs.
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// one line of df output, at the widest capacity any grid supports
+struct server_t {
+    using capacity_t = std::int32_t;
+
+    int        x;
+    int        y;
+    capacity_t capacity;
+};
+
+// the narrowest lanes (16 or 32 bits) that hold every capacity among these servers
+unsigned capacity_bits(std::vector<server_t> const& servers);
+
+enum class grid_neighbor { North, South, East, West, Invalid };
+grid_neighbor& operator++(grid_neighbor&);
+
+// Servers are laid out column by column, so server (x, y) is at offset x * height() + y,
+// and "north" and "south" neighbors are adjacent in memory. Each lane is a separate
+// 64-byte aligned array; all of them live in a single shared block, so copying a
+// grid is cheap.
+template<typename Capacity>
+struct basic_grid_t {
+    using capacity_t = Capacity;
+
+    // servers may be given in any order, but must cover a complete rectangle, and their
+    // capacities must fit in capacity_t
+    basic_grid_t(std::vector<server_t> const& servers,
+                 std::vector<server_t::capacity_t> const& usages);
+
+    // Adopt the lanes of a grid with these dimensions, as laid out by storage(), without
+    // copying - for example from a mapped snapshot. "storage" must be 64-byte aligned
+    // and is never written.
+    basic_grid_t(size_t width, size_t height, std::shared_ptr<void const> storage, size_t bytes);
+
+    // the single block holding every lane
+    void const * storage()       const;
+    size_t       storage_bytes() const;
+
+    size_t size()   const;
+    size_t width()  const;
+    size_t height() const;
+    size_t offset(int x, int y) const;
+
+    int        x(size_t offset)        const;
+    int        y(size_t offset)        const;
+    capacity_t capacity(size_t offset) const;
+    capacity_t usage(size_t offset)    const;     // as loaded
+    capacity_t avail(size_t offset)    const;     // capacity - usage
+
+    // offset of the adjacent server, or size() if there is none
+    size_t     neighbor(size_t offset, grid_neighbor dir) const;
+
+    // Walls: servers whose data is larger than the capacity of every neighbor.
+    // Moving data in only makes them larger, so they can never be a move source.
+    bool                   wall(size_t offset) const;
+    std::uint64_t const *  wall_bits()         const;   // bit (i % 64) of word i / 64
+
+    // raw lanes, each padded to a whole number of 64-server blocks
+    capacity_t const * capacities() const;
+    capacity_t const * usages()     const;
+    capacity_t const * avails()     const;
+
+private:
+    void bind(char * block);
+
+    // Legal moves out of every server in column x toward direction dir, given usage
+    // and free space lanes laid out like the grid. Bit y of the result (in words of 64)
+    // is set if server (x, y) has data that fits in its neighbor. Used to find walls.
+    void column_legal_moves(size_t x, grid_neighbor dir,
+                            capacity_t const * usage, capacity_t const * avail,
+                            std::uint64_t * mask) const;
+
+    size_t width_;
+    size_t height_;
+    size_t size_;
+    size_t padded_size_;
+
+    std::shared_ptr<void const> storage_;
+    capacity_t *            capacity_;
+    capacity_t *            usage_;
+    capacity_t *            avail_;
+    std::int32_t *          x_;
+    std::int32_t *          y_;
+    std::uint32_t *         neighbors_[4];
+    std::uint64_t *         walls_;
+};
+
+using grid_t      = basic_grid_t<std::int16_t>;
+using wide_grid_t = basic_grid_t<std::int32_t>;
+
+// Vectorized kernels (AVX2 or SSE2 where the compiler targets them, scalar otherwise)
+// The grid finds its walls with a legal move kernel; the viable pair count and the
+// initial receiver index scan free space with the one below. Successor generation
+// works from each state's receivers instead, and does not use them.
+// Masks are arrays of 64-bit words, bit i of word i / 64 corresponding to element i;
+// bits past "count" are cleared. Each comes in 16 and 32 bit versions.
+
+// bit i set iff values[i] >= threshold
+void at_least_mask(std::int16_t const * values, size_t count,
+                   std::int16_t threshold, std::uint64_t * mask);
+void at_least_mask(std::int32_t const * values, size_t count,
+                   std::int32_t threshold, std::uint64_t * mask);
+
+// which implementation the kernels use: "avx2", "sse2", or "scalar"
+char const * grid_kernel_name();
+
+// Use the scalar loops even where vector kernels were built, or go back to the vector
+// ones; for measuring what they save. Not thread safe, so call it before any search.
+void use_vector_kernels(bool on);
+
+#endif // GRID_H
@@ -0,0 +1,252 @@
+#ifndef HDA_SEARCH_H
+#define HDA_SEARCH_H
+
+// Hash-distributed A* (HDA*): a parallel search in which every state has an owning
+// thread, chosen by its hash. Each thread keeps its own open list and per-vertex
+// records, expands only states it owns, and sends successors owned by other threads
+// through lock-free queues.
+//
+// Threads keep working after the first goal is found, until no thread holds (and no
+// queue carries) a state whose f value could still beat it. An atomic count of busy
+// threads plus messages in flight detects that moment: senders count a message before
+// queueing it, receivers count themselves busy before uncounting it, so the total only
+// reaches zero when nothing is left anywhere. At that point the best goal found is
+// optimal for any admissible heuristic.
+//
+// Each thread also publishes the priority (f, then depth) of the best state on its open
+// list, and holds back from expanding anything worse than another thread's frontier.
+// Senders lower the receiver's frontier to account for the states they queue.
+// Without this, a thread that gets ahead (or simply gets the CPU to itself for a while)
+// expands many states that a sequential search would never touch.
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/graph/graph_traits.hpp>
+
+#include "mpsc_queue.h"
+#include "search.h"
+#include "stats.h"
+
+template<typename Graph, typename Heuristic>
+search_result_t<typename boost::graph_traits<Graph>::vertex_descriptor>
+hda_solve(Graph const& g,
+          typename boost::graph_traits<Graph>::vertex_descriptor const& start,
+          Heuristic h,
+          size_t thread_count) {
+    using vertex_t = typename boost::graph_traits<Graph>::vertex_descriptor;
+
+    thread_count = std::max<size_t>(thread_count, 1);
+
+    // a successor on its way to its owner
+    struct message_t {
+        vertex_t v;
+        vertex_t predecessor;
+        size_t   distance;
+        size_t   f;
+    };
+    struct vertex_record_t {
+        size_t   distance;
+        vertex_t predecessor;
+    };
+    struct open_entry_t {
+        size_t   f;
+        size_t   distance;
+        vertex_t v;
+    };
+    // lowest f first, breaking ties toward the deepest state
+    struct open_order_t {
+        bool operator()(open_entry_t const& a, open_entry_t const& b) const {
+            return (a.f > b.f) || ((a.f == b.f) && (a.distance < b.distance));
+        }
+    };
+    struct worker_t {
+        mpsc_queue_t<message_t>                       inbox;
+        std::unordered_map<vertex_t, vertex_record_t> records;
+        std::priority_queue<open_entry_t, std::vector<open_entry_t>, open_order_t> open;
+        size_t                                        examined = 0;
+        std::atomic<size_t>                           frontier{std::numeric_limits<size_t>::max()};
+    };
+    std::vector<std::unique_ptr<worker_t>> workers;
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers.emplace_back(new worker_t);
+    }
+
+    // spread the (possibly weakly mixed) state hash over the threads
+    auto owner = [thread_count](vertex_t const& v) -> size_t {
+        std::uint64_t mixed = std::hash<vertex_t>()(v) * 0x9e3779b97f4a7c15ull;
+        return (mixed >> 32) % thread_count;
+    };
+
+    // heuristics report unsolvable states as at least this far from the goal
+    constexpr size_t dead_end = std::numeric_limits<int>::max() / 2;
+
+    constexpr size_t no_solution = std::numeric_limits<size_t>::max();
+    std::atomic<size_t> best_cost(no_solution);
+    std::mutex          best_mutex;
+    vertex_t            best_goal;
+    std::atomic<long>   pending(static_cast<long>(thread_count));   // all threads start busy
+
+    // a state arrived at its owner by some path; keep it if that path is the best yet
+    auto receive = [&](worker_t & w, message_t const& m) {
+        auto it = w.records.find(m.v);
+        if ((it != w.records.end()) && (it->second.distance <= m.distance)) {
+            return;
+        }
+        if (m.f >= best_cost.load(std::memory_order_relaxed)) {
+            return;       // cannot lead to a better solution
+        }
+        if (it == w.records.end()) {
+            w.records.emplace(m.v, vertex_record_t{m.distance, m.predecessor});
+        } else {
+            it->second = vertex_record_t{m.distance, m.predecessor};
+        }
+        w.open.push(open_entry_t{m.f, m.distance, m.v});
+    };
+
+    {
+        worker_t & w = *workers[owner(start)];
+        w.records.emplace(start, vertex_record_t{0, start});
+        w.open.push(open_entry_t{static_cast<size_t>(h(start)), 0, start});
+    }
+
+    // the best priority any other thread is ready to expand
+    auto others_frontier = [&](size_t self) {
+        size_t lowest = std::numeric_limits<size_t>::max();
+        for (size_t i = 0; i < thread_count; ++i) {
+            if (i != self) {
+                lowest = std::min(lowest, workers[i]->frontier.load(std::memory_order_relaxed));
+            }
+        }
+        return lowest;
+    };
+
+    // open list order as one comparable number: f, then greater depth first
+    auto priority = [](size_t f, size_t distance) -> size_t {
+        return (f << 32) | (0xffffffffu - (distance & 0xffffffffu));
+    };
+
+    auto run = [&](size_t self) {
+        worker_t & w = *workers[self];
+        bool busy = true;
+        while (true) {
+            message_t m;
+            while (w.inbox.pop(m)) {
+                if (!busy) {
+                    pending.fetch_add(1, std::memory_order_acq_rel);
+                    busy = true;
+                }
+                receive(w, m);
+                pending.fetch_sub(1, std::memory_order_acq_rel);
+            }
+
+            // find something worth expanding
+            bool expanded = false;
+            bool waiting = false;
+            while (!w.open.empty() && !expanded && !waiting) {
+                open_entry_t e = w.open.top();
+                if ((e.distance != w.records.at(e.v).distance) ||           // stale entry
+                    (e.f >= best_cost.load(std::memory_order_relaxed))) {   // no use
+                    w.open.pop();
+                    continue;
+                }
+                w.frontier.store(priority(e.f, e.distance), std::memory_order_relaxed);
+                if (priority(e.f, e.distance) > others_frontier(self)) {
+                    waiting = true;          // let the others catch up
+                    continue;
+                }
+                w.open.pop();
+                ++w.examined;
+                D22_COUNT(examined);
+                expanded = true;
+                if (at_goal(g, e.v)) {
+                    std::lock_guard<std::mutex> lock(best_mutex);
+                    if (e.distance < best_cost.load(std::memory_order_relaxed)) {
+                        best_goal = e.v;
+                        best_cost.store(e.distance, std::memory_order_relaxed);
+                    }
+                    continue;
+                }
+                auto edges = out_edges(e.v, g);
+                for (auto ei = edges.first; ei != edges.second; ++ei) {
+                    message_t succ{target(*ei, g), e.v, e.distance + 1, 0};
+                    size_t succ_h = static_cast<size_t>(h(succ.v));
+                    if (succ_h >= dead_end) {
+                        continue;
+                    }
+                    succ.f = succ.distance + succ_h;
+                    size_t dest = owner(succ.v);
+                    if (dest == self) {
+                        receive(w, succ);
+                    } else {
+                        size_t p = priority(succ.f, succ.distance);
+                        auto & frontier = workers[dest]->frontier;
+                        size_t current = frontier.load(std::memory_order_relaxed);
+                        while ((p < current) &&
+                               !frontier.compare_exchange_weak(current, p,
+                                                               std::memory_order_relaxed)) {}
+                        pending.fetch_add(1, std::memory_order_acq_rel);
+                        workers[dest]->inbox.push(std::move(succ));
+                    }
+                }
+                D22_PEAK(open_peak, w.open.size());
+                D22_PROGRESS(w.examined, w.open.size(), e.f);
+            }
+            if (expanded) {
+                continue;
+            }
+            if (waiting) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            // nothing to do locally; stop when nothing remains anywhere
+            w.frontier.store(std::numeric_limits<size_t>::max(), std::memory_order_relaxed);
+            if (busy) {
+                busy = false;
+                pending.fetch_sub(1, std::memory_order_acq_rel);
+            }
+            if (pending.load(std::memory_order_acquire) == 0) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < thread_count; ++i) {
+        threads.emplace_back(run, i);
+    }
+    run(0);
+    for (auto & t : threads) {
+        t.join();
+    }
+
+    search_result_t<vertex_t> result;
+    for (auto const& w : workers) {
+        result.examined += w->examined;
+        result.examined_per_thread.push_back(w->examined);
+    }
+    if (best_cost.load() != no_solution) {
+        // follow predecessors back through their owners
+        stats::phase_t phase("path");
+        std::vector<vertex_t> & soln_path = result.path;
+        vertex_t next_state = best_goal;
+        do {
+            soln_path.push_back(next_state);
+            next_state = workers[owner(next_state)]->records.at(next_state).predecessor;
+        } while (!(soln_path.back() == next_state));
+        std::reverse(soln_path.begin(), soln_path.end());
+    }
+    return result;
+}
+
+#endif // HDA_SEARCH_H
@@ -0,0 +1,647 @@
+// Heuristics for the Advent of Code, Day 22 searches
+
+#include "heuristic.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+
+#include "stats.h"
+
+namespace {
+
+// moves needed before a hole can get around the data to another side are rarely many;
+// searching further than this just reports "at least 2 * reposition_radius"
+constexpr int reposition_radius = 6;
+
+grid_neighbor
+opposite(grid_neighbor dir) {
+    switch (dir) {
+    case grid_neighbor::North: return grid_neighbor::South;
+    case grid_neighbor::South: return grid_neighbor::North;
+    case grid_neighbor::East:  return grid_neighbor::West;
+    case grid_neighbor::West:  return grid_neighbor::East;
+    default:                   return grid_neighbor::Invalid;
+    }
+}
+
+}
+
+template<typename Capacity>
+constexpr std::uint32_t basic_distance_tables_t<Capacity>::unreachable;
+
+template<typename Capacity>
+basic_distance_tables_t<Capacity>::basic_distance_tables_t(graph_t const& g,
+                                                           size_t all_pairs_limit,
+                                                           size_t landmark_count)
+    : g_(g), n_(g.grid().size()), all_pairs_(n_ <= all_pairs_limit) {
+
+    if (all_pairs_) {
+        pair_dist_.resize(n_ * n_);
+        for (size_t from = 0; from < n_; ++from) {
+            auto dist = bfs(from);
+            std::transform(dist.begin(), dist.end(), pair_dist_.begin() + from * n_,
+                           [](std::uint32_t d) {
+                               return static_cast<std::uint16_t>(
+                                   std::min<std::uint32_t>(d, 0xffff));
+                           });
+        }
+    } else {
+        // Landmarks chosen by repeatedly taking the movable server farthest from those
+        // already chosen. The triangle inequality then gives, for any pair (a, b),
+        // |d(L, a) - d(L, b)| <= d(a, b)
+        std::vector<std::uint32_t> nearest(n_, unreachable);
+        size_t next = 0;
+        for (size_t l = 0; l < landmark_count; ++l) {
+            landmarks_.push_back(next);
+            auto dist = bfs(next);
+            landmark_dist_.insert(landmark_dist_.end(), dist.begin(), dist.end());
+            std::uint32_t farthest = 0;
+            for (size_t i = 0; i < n_; ++i) {
+                nearest[i] = std::min(nearest[i], dist[i]);
+                if ((nearest[i] != unreachable) && (nearest[i] > farthest)) {
+                    farthest = nearest[i];
+                    next = i;
+                }
+            }
+        }
+    }
+
+    tables_ = stored_t{all_pairs_, landmarks_.size(), pair_dist_.data(), landmarks_.data(),
+                       landmark_dist_.data(), nullptr, nullptr};
+    build_goal_tables();
+}
+
+template<typename Capacity>
+basic_distance_tables_t<Capacity>::basic_distance_tables_t(graph_t const& g,
+                                                           stored_t const& tables,
+                                                           std::shared_ptr<void const> storage)
+    : g_(g), n_(g.grid().size()), all_pairs_(tables.all_pairs), tables_(tables),
+      storage_(std::move(storage)) {
+    build_join_tables();
+}
+
+template<typename Capacity>
+basic_distance_tables_t<Capacity>::basic_distance_tables_t(graph_t const& g,
+                                                           basic_distance_tables_t const& other)
+    : g_(g), n_(g.grid().size()), all_pairs_(other.all_pairs_), tables_(other.tables_) {
+    if (other.n_ != n_) {
+        throw std::invalid_argument("distance tables are for a different grid");
+    }
+    build_goal_tables();
+}
+
+template<typename Capacity>
+stored_distance_tables_t
+basic_distance_tables_t<Capacity>::stored() const {
+    return tables_;
+}
+
+template<typename Capacity>
+bool
+basic_distance_tables_t<Capacity>::all_pairs() const {
+    return all_pairs_;
+}
+
+// breadth-first distances over non-wall servers
+template<typename Capacity>
+std::vector<std::uint32_t>
+basic_distance_tables_t<Capacity>::bfs(size_t from) const {
+    std::vector<std::uint32_t> dist(n_, unreachable);
+    if (g_.classification(from) == server_class::Wall) {
+        return dist;
+    }
+    std::deque<size_t> q{from};
+    dist[from] = 0;
+    while (!q.empty()) {
+        size_t cur = q.front();
+        q.pop_front();
+        for (grid_neighbor dir = grid_neighbor::North; dir <= grid_neighbor::West; ++dir) {
+            size_t next = g_.neighbor(cur, dir);
+            if ((next != n_) && (dist[next] == unreachable) &&
+                (g_.classification(next) != server_class::Wall)) {
+                dist[next] = dist[cur] + 1;
+                q.push_back(next);
+            }
+        }
+    }
+    return dist;
+}
+
+template<typename Capacity>
+std::uint32_t
+basic_distance_tables_t<Capacity>::hole_distance(size_t from, size_t to) const {
+    if (all_pairs_) {
+        std::uint16_t d = tables_.pair_dist[from * n_ + to];
+        return (d == 0xffff) ? unreachable : d;
+    }
+    auto const & grid = g_.grid();
+    std::uint32_t best = std::abs(grid.x(from) - grid.x(to)) +
+                         std::abs(grid.y(from) - grid.y(to));
+    for (size_t l = 0; l < tables_.landmark_count; ++l) {
+        std::uint32_t a = tables_.landmark_dist[l * n_ + from];
+        std::uint32_t b = tables_.landmark_dist[l * n_ + to];
+        if ((a == unreachable) != (b == unreachable)) {
+            return unreachable;          // different components
+        }
+        if (a != unreachable) {
+            best = std::max(best, (a > b) ? (a - b) : (b - a));
+        }
+    }
+    return best;
+}
+
+template<typename Capacity>
+std::uint32_t
+basic_distance_tables_t<Capacity>::goal_distance(size_t server) const {
+    return tables_.goal_dist[server];
+}
+
+template<typename Capacity>
+std::uint32_t
+basic_distance_tables_t<Capacity>::data_cost(size_t data, grid_neighbor dir) const {
+    return tables_.data_cost[data * 4 + static_cast<size_t>(dir)];
+}
+
+template<typename Capacity>
+std::uint32_t
+basic_distance_tables_t<Capacity>::join_cost(size_t server, std::uint32_t first,
+                                             size_t holes) const {
+    if ((holes != join_holes_) || (join_levels_ == 0)) {
+        return 0;
+    }
+    size_t level = std::min<size_t>(first / join_step_, join_levels_ - 1);
+    std::int64_t near = join_near_[level * n_ + server];
+    std::int64_t far = join_far_[level * n_ + server];
+    std::int64_t best = std::min(near + first, far) - 1;
+    return static_cast<std::uint32_t>(std::max<std::int64_t>(best, 0));
+}
+
+// Moves for the hole to get from one side of the data to another without passing
+// through it. Found by a BFS confined to a small window around the data. A path that
+// leaves the window takes at least reposition_radius moves out and as many back, so
+// longer paths inside it, and paths it does not contain, count as that many.
+template<typename Capacity>
+std::uint32_t
+basic_distance_tables_t<Capacity>::reposition_cost(size_t data, grid_neighbor from,
+                                                   grid_neighbor to) const {
+    constexpr int width = 2 * reposition_radius + 1;
+    auto const & grid = g_.grid();
+    int cx = grid.x(data);
+    int cy = grid.y(data);
+    auto window_index = [&](size_t s) {
+        int dx = grid.x(s) - cx + reposition_radius;
+        int dy = grid.y(s) - cy + reposition_radius;
+        if ((dx < 0) || (dx >= width) || (dy < 0) || (dy >= width)) {
+            return -1;
+        }
+        return dx * width + dy;
+    };
+
+    size_t start = g_.neighbor(data, from);
+    size_t goal = g_.neighbor(data, to);
+    constexpr std::uint32_t leaving = 2 * reposition_radius;
+    std::array<std::int16_t, width * width> dist;
+    dist.fill(-1);
+    dist[window_index(start)] = 0;
+    dist[window_index(data)] = 0;        // blocked
+    std::deque<size_t> q{start};
+    while (!q.empty()) {
+        size_t cur = q.front();
+        q.pop_front();
+        if (cur == goal) {
+            return std::min<std::uint32_t>(dist[window_index(cur)], leaving);
+        }
+        for (grid_neighbor dir = grid_neighbor::North; dir <= grid_neighbor::West; ++dir) {
+            size_t next = g_.neighbor(cur, dir);
+            if ((next == n_) || (g_.classification(next) == server_class::Wall)) {
+                continue;
+            }
+            int wi = window_index(next);
+            if ((wi >= 0) && (dist[wi] < 0)) {
+                dist[wi] = dist[window_index(cur)] + 1;
+                q.push_back(next);
+            }
+        }
+    }
+    // not found within the window: any path must leave it, if there is one at all
+    return leaving;
+}
+
+// Build the distances to the goal, and the pattern database by Dijkstra backward
+// from the goal
+// An abstract state is the data position plus which side of it the hole is on.
+// Forward moves are sliding the data into the hole (cost 1, the hole ends up on the
+// opposite side) and moving the hole to another side (cost reposition_cost).
+template<typename Capacity>
+void
+basic_distance_tables_t<Capacity>::build_goal_tables() {
+    size_t const target = g_.goal();
+    goal_dist_ = bfs(target);
+    data_cost_.assign(n_ * 4, unreachable);
+    tables_.goal_dist = goal_dist_.data();
+    tables_.data_cost = data_cost_.data();
+
+    using entry_t = std::tuple<std::uint32_t, size_t, grid_neighbor>;
+    std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> q;
+    for (grid_neighbor dir = grid_neighbor::North; dir <= grid_neighbor::West; ++dir) {
+        size_t n = g_.neighbor(target, dir);
+        if ((n != n_) && (g_.classification(n) != server_class::Wall)) {
+            data_cost_[target * 4 + static_cast<size_t>(dir)] = 0;
+            q.emplace(0, target, dir);
+        }
+    }
+
+    auto relax = [&](size_t data, grid_neighbor dir, std::uint32_t cost) {
+        std::uint32_t & current = data_cost_[data * 4 + static_cast<size_t>(dir)];
+        if (cost < current) {
+            current = cost;
+            q.emplace(cost, data, dir);
+        }
+    };
+
+    while (!q.empty()) {
+        std::uint32_t cost;
+        size_t data;
+        grid_neighbor dir;
+        std::tie(cost, data, dir) = q.top();
+        q.pop();
+        if (cost != data_cost_[data * 4 + static_cast<size_t>(dir)]) {
+            continue;        // stale
+        }
+
+        // the data could have arrived here by sliding from the server on side "dir"
+        size_t prev = g_.neighbor(data, dir);
+        if (prev != target) {
+            relax(prev, opposite(dir), cost + 1);
+        }
+
+        // or the hole may have come around from another side
+        for (grid_neighbor other = grid_neighbor::North; other <= grid_neighbor::West; ++other) {
+            size_t n = g_.neighbor(data, other);
+            if ((other == dir) || (n == n_) || (g_.classification(n) == server_class::Wall) ||
+                (data == target)) {
+                continue;
+            }
+            std::uint32_t step = reposition_cost(data, other, dir);
+            if (step != unreachable) {
+                relax(data, other, cost + step);
+            }
+        }
+    }
+    build_join_tables();
+}
+
+// Tables bounding solutions in which a second hole takes the target data
+// Say the hole that slides the data first has single-hole estimate E, and a second hole
+// first slides it from p. The first hole's moves up to its last slide cost at least E
+// less c(p), the largest pattern database cost over p's sides (infinite if any cannot
+// finish), since the database holds shortest distances. The second hole travels at
+// least its distance to p less one, and from p on it takes at least r(p), what the
+// estimate below gives from the data's distance to the goal alone. So the moves left
+// number at least the minimum over p of
+//     max(E - c(p), 0) + dist(hole, p) - 1 + r(p),
+// which is at least E + dist(hole, p) + r(p) - c(p) - 1 and at least
+// dist(hole, p) + r(p) - 1, whichever set p is put in. Both are shortest distances from
+// many sources, found for every hole at once. Estimates E are grouped into levels of
+// join_step_, each putting p in the first set when c(p) is below the level's top, so
+// a lookup is O(1) and gives up at most join_step_.
+template<typename Capacity>
+void
+basic_distance_tables_t<Capacity>::build_join_tables() {
+    join_holes_ = g_.holes().size();
+    join_step_ = 1;
+    join_levels_ = 0;
+    join_near_.clear();
+    join_far_.clear();
+    if (join_holes_ < 2) {
+        return;
+    }
+
+    size_t const target = g_.goal();
+    constexpr std::int64_t none = std::numeric_limits<std::int32_t>::max();
+    std::vector<std::int64_t> cost(n_, none);     // c(p), none if some side cannot finish
+    std::vector<std::int64_t> rest(n_, none);     // r(p), none where p cannot be
+    std::uint32_t most = 0;
+    for (size_t p = 0; p < n_; ++p) {
+        std::uint32_t travel = goal_distance(p);
+        if ((p == target) || (travel == unreachable)) {
+            continue;
+        }
+        std::uint32_t c = 0;
+        for (grid_neighbor dir = grid_neighbor::North; dir <= grid_neighbor::West; ++dir) {
+            size_t side = g_.neighbor(p, dir);
+            if ((side != n_) && (g_.classification(side) != server_class::Wall)) {
+                c = std::max(c, data_cost(p, dir));
+            }
+        }
+        rest[p] = travel;
+        if (join_holes_ <= 3) {
+            rest[p] = std::max<std::int64_t>(travel, 3 * std::int64_t(travel) - 2 * join_holes_);
+        }
+        if (c != unreachable) {
+            cost[p] = c;
+            most = std::max(most, c);
+        }
+    }
+
+    // at most 64 levels, so the tables stay within 128 entries per server
+    join_step_ = std::max<std::uint32_t>(2, (most + 63) / 64);
+    join_levels_ = most / join_step_ + 1;
+    join_near_.resize(join_levels_ * n_);
+    join_far_.resize(join_levels_ * n_);
+
+    // shortest distances over movable servers from sources with the given costs
+    auto spread = [this, none](std::vector<std::int64_t> const& source, std::int32_t * out) {
+        using entry_t = std::pair<std::int64_t, size_t>;
+        std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> q;
+        std::vector<std::int64_t> dist(source);
+        for (size_t p = 0; p < n_; ++p) {
+            if (dist[p] != none) {
+                q.emplace(dist[p], p);
+            }
+        }
+        while (!q.empty()) {
+            std::int64_t d = q.top().first;
+            size_t cur = q.top().second;
+            q.pop();
+            if (d != dist[cur]) {
+                continue;
+            }
+            for (grid_neighbor dir = grid_neighbor::North; dir <= grid_neighbor::West; ++dir) {
+                size_t next = g_.neighbor(cur, dir);
+                if ((next != n_) && (g_.classification(next) != server_class::Wall) &&
+                    (d + 1 < dist[next])) {
+                    dist[next] = d + 1;
+                    q.emplace(d + 1, next);
+                }
+            }
+        }
+        std::copy(dist.begin(), dist.end(), out);
+    };
+
+    std::vector<std::int64_t> near_source(n_), far_source(n_);
+    for (size_t level = 0; level < join_levels_; ++level) {
+        std::int64_t limit = std::int64_t(level + 1) * join_step_;
+        for (size_t p = 0; p < n_; ++p) {
+            bool in_near = (cost[p] != none) && (cost[p] < limit);
+            near_source[p] = in_near ? (rest[p] - cost[p]) : none;
+            far_source[p] = in_near ? none : rest[p];
+        }
+        spread(near_source, join_near_.data() + level * n_);
+        spread(far_source, join_far_.data() + level * n_);
+    }
+}
+
+template<typename Capacity>
+int
+basic_manhattan_move_heuristic_t<Capacity>::operator()(
+    const basic_server_state_t<Capacity>& v) const {
+    D22_TIME_HEURISTIC();
+    // Finding the distance to the "blank tile"
+    // First, find the nearest (to the goal) server of sufficient reserve capacity
+    // to hold the target data. Only receivers can have that much space.
+
+    std::vector<size_t> eligible_servers;
+    for (size_t i : v.receivers()) {
+        if ((grid_.capacity(i) - v.usage(i)) >= v.usage(v.data_offset())) {
+            eligible_servers.push_back(i);
+        }
+    }
+    return estimate(v.data_offset(), eligible_servers);
+}
+
+template<typename Capacity>
+int
+basic_manhattan_move_heuristic_t<Capacity>::operator()(const reduced_state_t& v) const {
+    D22_TIME_HEURISTIC();
+    // in the reduced state space the holes are exactly the eligible servers
+    std::vector<size_t> eligible_servers;
+    for (size_t i = 0; i < v.hole_count(); ++i) {
+        eligible_servers.push_back(v.hole(i));
+    }
+    return estimate(v.data_offset(), eligible_servers);
+}
+
+template<typename Capacity>
+int
+basic_manhattan_move_heuristic_t<Capacity>::estimate(
+    size_t current_server, std::vector<size_t> const& eligible_servers) const {
+    int cx = grid_.x(current_server);
+    int cy = grid_.y(current_server);
+    int gx = grid_.x(goal_);
+    int gy = grid_.y(goal_);
+
+    // Heuristic plan:
+    // We need enough steps to move the original data to the goal
+    // That ends up being about 5 times the Manhattan distance due to the need to move
+    // the "blank tile" (server with sufficient capacity) back into place between the
+    // target data and the goal each time.
+    // In addition, we need to move the "blank tile" into position in the first place.
+
+    // Manhattan distance to goal
+    // we must make at least this many moves to get the original data home
+    int mdist = abs(cx - gx) + abs(cy - gy);
+
+    // if mdist is 0, we are at the target, so simply return 0
+    if (mdist == 0) {
+        return 0;
+    }
+
+    // take the one with the minimum Manhattan distance to the server with our data
+    auto min_it = min_element(eligible_servers.begin(), eligible_servers.end(),
+                              [this, cx, cy](size_t a, size_t b) {
+                                  return ((abs(cx - grid_.x(a)) + abs(cy - grid_.y(a))) <
+                                          (abs(cx - grid_.x(b)) + abs(cy - grid_.y(b))));
+                              });
+    assert(min_it != eligible_servers.end());   // insoluble!
+
+    // calculate distance to the point beside the target data in the direction of the
+    // goal, vertically or horizontally, whichever is shorter
+    int hole_dist = std::numeric_limits<int>::max();
+    int hx = grid_.x(*min_it);
+    int hy = grid_.y(*min_it);
+    if (cy != gy) {
+        // distance to point above (or below) target
+        int ty = (cy > gy) ? (cy - 1) : (cy + 1);
+        hole_dist = abs(ty - hy) + abs(cx - hx);
+    }
+    if (cx != gx) {
+        // distance to point left (or right) of target
+        int tx = (cx > gx) ? (cx - 1) : (cx + 1);
+        hole_dist = std::min(hole_dist, abs(tx - hx) + abs(cy - hy));
+    }
+
+    // each move of the target data requires 5 moves overall, except for the last one
+    return (5*(mdist-1)+ 1) + hole_dist;
+}
+
+template<typename Capacity>
+basic_server_move_heuristic_t<Capacity>::basic_server_move_heuristic_t(
+    basic_move_graph_t<Capacity> const& g, basic_distance_tables_t<Capacity> const& tables)
+    : g_(g), tables_(tables), fallback_(g.grid(), g.goal()) {}
+
+template<typename Capacity>
+int
+basic_server_move_heuristic_t<Capacity>::operator()(
+    const basic_server_state_t<Capacity>& v) const {
+    D22_TIME_HEURISTIC();
+    if (!g_.abstraction_sound()) {
+        return fallback_(v);
+    }
+    // the grid is equivalent to the reduced one, so the holes are the empty servers,
+    // all of which are receivers
+    std::vector<size_t> holes;
+    for (size_t i : v.receivers()) {
+        if (v.usage(i) == 0) {
+            holes.push_back(i);
+        }
+    }
+    return estimate(v.data_offset(), holes);
+}
+
+template<typename Capacity>
+int
+basic_server_move_heuristic_t<Capacity>::operator()(const reduced_state_t& v) const {
+    D22_TIME_HEURISTIC();
+    std::vector<size_t> holes;
+    for (size_t i = 0; i < v.hole_count(); ++i) {
+        holes.push_back(v.hole(i));
+    }
+    return estimate(v.data_offset(), holes);
+}
+
+template<typename Capacity>
+int
+basic_server_move_heuristic_t<Capacity>::estimate(size_t data,
+                                                  std::vector<size_t> const& holes) const {
+    // anything we cannot finish from is effectively infinitely far away, but the search
+    // adds path lengths to this so leave some headroom
+    constexpr std::uint32_t dead_end = std::numeric_limits<int>::max() / 2;
+
+    if (data == g_.goal()) {
+        return 0;
+    }
+
+    // the bound for one hole doing all the work: its distance to a side of the data
+    // plus the pattern database cost from there
+    auto alone = [this, data](size_t hole) {
+        std::uint32_t best = basic_distance_tables_t<Capacity>::unreachable;
+        for (grid_neighbor dir = grid_neighbor::North; dir <= grid_neighbor::West; ++dir) {
+            size_t side = g_.neighbor(data, dir);
+            if ((side == g_.grid().size()) ||
+                (g_.classification(side) == server_class::Wall)) {
+                continue;
+            }
+            std::uint32_t approach = tables_.hole_distance(hole, side);
+            std::uint32_t rest = tables_.data_cost(data, dir);
+            if ((approach != basic_distance_tables_t<Capacity>::unreachable) &&
+                (rest != basic_distance_tables_t<Capacity>::unreachable)) {
+                best = std::min(best, approach + rest);
+            }
+        }
+        return best;
+    };
+
+    if (holes.size() == 1) {
+        return static_cast<int>(std::min(alone(holes[0]), dead_end));
+    }
+
+    // Several holes could cooperate, so only count what must happen regardless:
+    // some hole reaches the data, then the data travels home
+    std::uint32_t travel = tables_.goal_distance(data);
+    if (travel == basic_distance_tables_t<Capacity>::unreachable) {
+        return static_cast<int>(dead_end);
+    }
+    std::uint32_t best = dead_end;
+    for (size_t h : holes) {
+        std::uint32_t approach = tables_.hole_distance(h, data);
+        if (approach != basic_distance_tables_t<Capacity>::unreachable) {
+            best = std::min(best, travel + ((approach > 0) ? (approach - 1) : 0));
+        }
+    }
+    if (best == dead_end) {
+        return static_cast<int>(best);
+    }
+
+    // Either one hole slides the data all the way, or a second one joins in
+    std::vector<std::uint32_t> first(holes.size());
+    std::uint32_t work = dead_end;
+    for (size_t i = 0; i < holes.size(); ++i) {
+        first[i] = alone(holes[i]);
+        work = std::min(work, first[i]);
+    }
+    for (size_t i = 0; i < holes.size(); ++i) {
+        for (size_t j = 0; j < holes.size(); ++j) {
+            if (i != j) {
+                work = std::min(work, tables_.join_cost(holes[j], first[i], holes.size()));
+            }
+        }
+    }
+    best = std::max(best, work);
+    if (holes.size() > 3) {
+        return static_cast<int>(best);
+    }
+
+    // With at most three holes, also three moves per step home, less what holes already
+    // ahead of the data save. Take r as a hole's distance to the goal less the data's.
+    // Sliding the data a step closer needs a hole at r = -1, leaves it at r = +1 and
+    // adds one to every other r; sliding it away does the reverse; any other move
+    // changes one r by one. Crediting each hole min(2, max(0, 1 - r)), no move lowers
+    // 3 * travel - credit by more than one, so it bounds the moves left from below.
+    std::uint32_t credit = 0;
+    std::uint32_t nearest = basic_distance_tables_t<Capacity>::unreachable;
+    for (size_t h : holes) {
+        std::uint32_t hd = tables_.goal_distance(h);
+        if (hd < travel) {
+            credit += std::min<std::uint32_t>(2, travel + 1 - hd);
+        } else if (hd == travel) {
+            credit += 1;
+        }
+        nearest = std::min(nearest, hd);
+    }
+    // and until some hole reaches r = 1, none can be used
+    std::uint32_t lag = ((nearest != basic_distance_tables_t<Capacity>::unreachable) &&
+                         (nearest > travel + 1)) ? (nearest - travel - 1) : 0;
+    return static_cast<int>(std::max(best, 3 * travel + lag - std::min(credit, 3 * travel)));
+}
+
+template<typename Capacity>
+basic_reverse_move_heuristic_t<Capacity>::basic_reverse_move_heuristic_t(
+    basic_reduced_move_graph_t<Capacity> const& g,
+    basic_distance_tables_t<Capacity> const& tables)
+    : tables_(tables), start_(g.initial_state()) {}
+
+template<typename Capacity>
+int
+basic_reverse_move_heuristic_t<Capacity>::operator()(const reduced_state_t& v) const {
+    D22_TIME_HEURISTIC();
+    std::uint32_t best = tables_.hole_distance(start_.data_offset(), v.data_offset());
+    for (size_t i = 0; i < v.hole_count(); ++i) {
+        // some starting hole became this one
+        std::uint32_t nearest = basic_distance_tables_t<Capacity>::unreachable;
+        for (size_t j = 0; j < start_.hole_count(); ++j) {
+            nearest = std::min(nearest, tables_.hole_distance(start_.hole(j), v.hole(i)));
+        }
+        best = std::max(best, nearest);
+    }
+    // unreachable from the start
+    constexpr std::uint32_t dead_end = std::numeric_limits<int>::max() / 2;
+    return static_cast<int>(std::min(best, dead_end));
+}
+
+template struct basic_distance_tables_t<std::int16_t>;
+template struct basic_distance_tables_t<std::int32_t>;
+template struct basic_manhattan_move_heuristic_t<std::int16_t>;
+template struct basic_manhattan_move_heuristic_t<std::int32_t>;
+template struct basic_server_move_heuristic_t<std::int16_t>;
+template struct basic_server_move_heuristic_t<std::int32_t>;
+template struct basic_reverse_move_heuristic_t<std::int16_t>;
+template struct basic_reverse_move_heuristic_t<std::int32_t>;
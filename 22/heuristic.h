@@ -0,0 +1,168 @@
+#ifndef HEURISTIC_H
+#define HEURISTIC_H
+
+// Heuristics to guide the A* search
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "graph.h"
+#include "reduced_graph.h"
+
+// The distance tables as flat arrays, n = g.grid().size():
+// all-pairs distances (n * n, 0xffff for unreachable) when all_pairs is set,
+// otherwise the landmarks and their distances (n per landmark); then the distance
+// to the goal (n) and the pattern database (4 per server, by direction)
+// They depend only on the grid's shape and walls and on the goal, not on its capacity
+// type; only the last two depend on the goal.
+struct stored_distance_tables_t {
+    bool                   all_pairs;
+    size_t                 landmark_count;
+    std::uint16_t const *  pair_dist;
+    std::uint64_t const *  landmarks;
+    std::uint32_t const *  landmark_dist;
+    std::uint32_t const *  goal_dist;
+    std::uint32_t const *  data_cost;
+};
+
+// Precomputed wall-aware distances over the movable servers
+// Built once at startup; afterwards every lookup is O(1), or O(landmarks) on grids
+// too large for an all-pairs table.
+template<typename Capacity>
+struct basic_distance_tables_t {
+    using graph_t  = basic_move_graph_t<Capacity>;
+    using stored_t = stored_distance_tables_t;
+
+    static constexpr std::uint32_t unreachable = 0xffffffff;
+
+    explicit basic_distance_tables_t(graph_t const& g,
+                                     size_t all_pairs_limit = 2048,
+                                     size_t landmark_count = 8);
+
+    stored_t stored() const;
+
+    basic_distance_tables_t(basic_distance_tables_t const&) = delete;   // lookups point into it
+    basic_distance_tables_t& operator=(basic_distance_tables_t const&) = delete;
+
+    // use tables previously built for the same grid, e.g. from a snapshot, without
+    // copying them; "storage" keeps the arrays alive
+    basic_distance_tables_t(graph_t const& g, stored_t const& tables,
+                            std::shared_ptr<void const> storage);
+
+    // tables for g's goal that share the hole distances of "other", which must have
+    // been built for a graph with the same walls and must outlive this object
+    basic_distance_tables_t(graph_t const& g, basic_distance_tables_t const& other);
+
+    // lower bound on moves for a hole to travel from one server to another
+    // (exact when all_pairs() is true)
+    std::uint32_t hole_distance(size_t from, size_t to) const;
+
+    // Pattern database: minimum moves to bring the target data from "data" to the
+    // goal when the single hole starts next to it, on side "dir"
+    std::uint32_t data_cost(size_t data, grid_neighbor dir) const;
+
+    // distance from a server to the goal, ignoring holes entirely
+    std::uint32_t goal_distance(size_t server) const;
+
+    // With "holes" holes: a lower bound on all the moves left when a hole on "server"
+    // is the second to take the target data, and the one before it has single-hole
+    // estimate "first". 0 unless the graph had that many holes when the tables were
+    // built (see build_join_tables).
+    std::uint32_t join_cost(size_t server, std::uint32_t first, size_t holes) const;
+
+    bool all_pairs() const;
+
+private:
+    std::vector<std::uint32_t> bfs(size_t from) const;
+    std::uint32_t reposition_cost(size_t data, grid_neighbor from, grid_neighbor to) const;
+    void build_goal_tables();
+    void build_join_tables();
+
+    graph_t const &              g_;
+    size_t                       n_;
+    bool                         all_pairs_;
+    stored_t                     tables_;         // what lookups use
+    std::shared_ptr<void const>  storage_;        // if the tables were not built here
+
+    // storage for tables built here
+    std::vector<std::uint16_t>   pair_dist_;      // n_ * n_ when all_pairs_
+    std::vector<std::uint64_t>   landmarks_;
+    std::vector<std::uint32_t>   landmark_dist_;  // n_ per landmark otherwise
+    std::vector<std::uint32_t>   goal_dist_;
+    std::vector<std::uint32_t>   data_cost_;      // 4 per server, indexed by direction
+
+    // derived from the goal tables rather than stored, and only for several holes
+    size_t                       join_holes_;
+    std::uint32_t                join_step_;      // range of "first" estimates per level
+    size_t                       join_levels_;
+    std::vector<std::int32_t>    join_near_;      // n_ per level
+    std::vector<std::int32_t>    join_far_;       // ... likewise
+};
+
+using distance_tables_t = basic_distance_tables_t<std::int16_t>;
+
+// The original estimate: five moves per step of Manhattan distance for the target
+// data, plus the Manhattan distance for the nearest hole to get in front of it.
+// Walls are ignored, and every call scans all servers.
+template<typename Capacity>
+struct basic_manhattan_move_heuristic_t {
+    basic_manhattan_move_heuristic_t(basic_grid_t<Capacity> const& grid, size_t goal = 0)
+        : grid_(grid), goal_(goal) {}
+
+    int operator()(const basic_server_state_t<Capacity>& v) const;
+    int operator()(const reduced_state_t& v) const;
+
+private:
+    int estimate(size_t current_server, std::vector<size_t> const& eligible_servers) const;
+
+    basic_grid_t<Capacity> const & grid_;
+    size_t                         goal_;
+};
+
+using manhattan_move_heuristic_t = basic_manhattan_move_heuristic_t<std::int16_t>;
+
+// Table-driven heuristic
+// With a single hole, the estimate is the hole's wall-aware distance to a side of the
+// target data plus the pattern database cost from there, minimized over the sides.
+// With several holes, that bound still holds for a solution in which one hole does
+// all the work; solutions that bring in a second hole are bounded with join_cost(),
+// and the estimate is the smaller of the two. If the grid does not meet the reduced
+// state conditions, the original Manhattan estimate is used.
+template<typename Capacity>
+struct basic_server_move_heuristic_t {
+    basic_server_move_heuristic_t(basic_move_graph_t<Capacity> const& g,
+                                  basic_distance_tables_t<Capacity> const& tables);
+
+    int operator()(const basic_server_state_t<Capacity>& v) const;
+    int operator()(const reduced_state_t& v) const;
+
+private:
+    int estimate(size_t data, std::vector<size_t> const& holes) const;
+
+    basic_move_graph_t<Capacity> const &        g_;
+    basic_distance_tables_t<Capacity> const &   tables_;
+    basic_manhattan_move_heuristic_t<Capacity>  fallback_;
+};
+
+using server_move_heuristic_t = basic_server_move_heuristic_t<std::int16_t>;
+
+// Estimate for searching backward: moves from the starting state to a reduced state
+// Every move slides exactly one hole to an adjacent server, and moves the target data at
+// most one step, so neither the data nor any hole can have traveled farther than the
+// number of moves made. The larger of those distances is admissible and consistent.
+template<typename Capacity>
+struct basic_reverse_move_heuristic_t {
+    basic_reverse_move_heuristic_t(basic_reduced_move_graph_t<Capacity> const& g,
+                                   basic_distance_tables_t<Capacity> const& tables);
+
+    int operator()(const reduced_state_t& v) const;
+
+private:
+    basic_distance_tables_t<Capacity> const &  tables_;
+    reduced_state_t                            start_;
+};
+
+using reverse_move_heuristic_t = basic_reverse_move_heuristic_t<std::int16_t>;
+
+#endif // HEURISTIC_H
@@ -0,0 +1,171 @@
+#ifndef IDA_SEARCH_H
+#define IDA_SEARCH_H
+
+// Memory-bounded search: iterative-deepening A* (IDA*) with a transposition table
+// Each iteration is a depth-first search that abandons any state whose f value exceeds
+// the current bound; the next bound is the smallest f value abandoned. Memory use is
+// the current path and its untried siblings, plus a transposition table of fixed size.
+//
+// The table remembers, for states whose subtree has been searched, an improved
+// heuristic: if the subtree below a state reached at depth g turned up nothing under
+// bound B, and the smallest f it abandoned was f', then at least f' - g moves remain.
+// That is admissible whatever depth the state is reached at, so it is safe to use in
+// later iterations and along other paths, and it prunes any repeat visit at the same
+// or greater depth within an iteration. Entries hold the state itself, compared before
+// its bound is used, and are overwritten when two states share a slot, so the table
+// only ever costs revisits, never correctness, whatever its size. Its size counts the
+// states' fixed parts; the full state's shared usage lists are kept alive beyond it.
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <boost/graph/graph_traits.hpp>
+
+#include "search.h"
+#include "stats.h"
+
+template<typename Graph, typename Heuristic>
+search_result_t<typename boost::graph_traits<Graph>::vertex_descriptor>
+ida_solve(Graph const& g,
+          typename boost::graph_traits<Graph>::vertex_descriptor const& start,
+          Heuristic h,
+          size_t table_bytes) {
+    using vertex_t = typename boost::graph_traits<Graph>::vertex_descriptor;
+
+    // heuristics report unsolvable states as at least this far from the goal
+    constexpr size_t dead_end = std::numeric_limits<int>::max() / 2;
+    constexpr size_t unbounded = std::numeric_limits<size_t>::max();
+
+    struct table_entry_t {
+        vertex_t      v;
+        std::uint64_t key;
+        std::uint32_t h;       // improved estimate; 0 in an unused entry
+    };
+    std::vector<table_entry_t> table(std::max<size_t>(table_bytes / sizeof(table_entry_t), 1),
+                                     table_entry_t{vertex_t(), 0, 0});
+    auto slot = [&table](std::uint64_t key) -> table_entry_t& {
+        return table[(key * 0x9e3779b97f4a7c15ull >> 16) % table.size()];
+    };
+    // the entry for this state, if the table has one
+    auto lookup = [&slot](vertex_t const& v, std::uint64_t key) -> table_entry_t const * {
+        table_entry_t const & e = slot(key);
+        return ((e.h != 0) && (e.key == key) && (e.v == v)) ? &e : nullptr;
+    };
+    auto estimate = [&](vertex_t const& v, std::uint64_t key) -> size_t {
+        size_t est = static_cast<size_t>(h(v));
+        table_entry_t const * e = lookup(v, key);
+        return e ? std::max<size_t>(est, e->h) : est;
+    };
+
+    // one state on the current path, with the successors still to try
+    struct frame_t {
+        vertex_t                                  v;
+        std::uint64_t                             key;
+        size_t                                    distance;
+        size_t                                    h;
+        std::vector<std::pair<size_t, vertex_t>>  successors;   // (f, state), best first
+        size_t                                    next;
+        size_t                                    min_exceeded; // smallest f abandoned below
+    };
+    std::vector<frame_t> path;
+
+    search_result_t<vertex_t> result;
+
+    auto on_path = [&path](vertex_t const& v, std::uint64_t key) {
+        for (auto it = path.rbegin(); it != path.rend(); ++it) {
+            if ((it->key == key) && (it->v == v)) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // examine a state within bound, queueing the successors that stay within it.
+    // Returns true if it is the goal.
+    auto enter = [&](vertex_t const& v, std::uint64_t key, size_t distance, size_t est,
+                     size_t bound) {
+        ++result.examined;
+        D22_COUNT(examined);
+        if (lookup(v, key)) {
+            ++result.reexpanded;
+        }
+        path.push_back(frame_t{v, key, distance, est, {}, 0, unbounded});
+        D22_PEAK(open_peak, path.size());
+        D22_PROGRESS(result.examined, path.size(), bound);
+        if (at_goal(g, v)) {
+            return true;
+        }
+        frame_t & f = path.back();
+        auto edges = out_edges(v, g);
+        for (auto ei = edges.first; ei != edges.second; ++ei) {
+            vertex_t succ = target(*ei, g);
+            std::uint64_t succ_key = std::hash<vertex_t>()(succ);
+            if (on_path(succ, succ_key)) {
+                continue;
+            }
+            size_t succ_h = estimate(succ, succ_key);
+            if (succ_h >= dead_end) {
+                continue;
+            }
+            size_t succ_f = distance + 1 + succ_h;
+            if (succ_f > bound) {
+                f.min_exceeded = std::min(f.min_exceeded, succ_f);
+                continue;
+            }
+            f.successors.emplace_back(succ_f, std::move(succ));
+        }
+        std::stable_sort(f.successors.begin(), f.successors.end(),
+                         [](std::pair<size_t, vertex_t> const& a,
+                            std::pair<size_t, vertex_t> const& b) {
+                             return a.first < b.first;
+                         });
+        return false;
+    };
+
+    std::uint64_t start_key = std::hash<vertex_t>()(start);
+    size_t bound = static_cast<size_t>(h(start));
+    while (bound < dead_end) {
+        ++result.iterations;
+        path.clear();
+        bool found = enter(start, start_key, 0, bound, bound);
+        while (!found && !path.empty()) {
+            frame_t & top = path.back();
+            if (top.next < top.successors.size()) {
+                auto & succ = top.successors[top.next++];
+                vertex_t v = std::move(succ.second);
+                std::uint64_t key = std::hash<vertex_t>()(v);
+                found = enter(v, key, top.distance + 1, succ.first - top.distance - 1, bound);
+                continue;
+            }
+            // subtree exhausted: remember how far the goal must be, and report upward
+            size_t exceeded = top.min_exceeded;
+            if (exceeded != unbounded) {
+                size_t improved = std::max(top.h, exceeded - top.distance);
+                table_entry_t & e = slot(top.key);
+                e.v = top.v;
+                e.key = top.key;
+                e.h = static_cast<std::uint32_t>(std::min<size_t>(improved, dead_end));
+            }
+            path.pop_back();
+            if (!path.empty()) {
+                path.back().min_exceeded = std::min(path.back().min_exceeded, exceeded);
+            } else {
+                bound = exceeded;
+            }
+        }
+        if (found) {
+            stats::phase_t phase("path");
+            for (auto const& f : path) {
+                result.path.push_back(f.v);
+            }
+            break;
+        }
+    }
+    return result;
+}
+
+#endif // IDA_SEARCH_H
@@ -0,0 +1,197 @@
+// Loader for df listings, for Advent of Code, Day 22
+
+#include "loader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+#include "mapped_file.h"
+
+namespace {
+
+char const prefix[] = "/dev/grid/node-";
+constexpr size_t prefix_len = sizeof(prefix) - 1;
+
+// one chunk's results; if "error" is set, parsing stopped at line "lines"
+struct chunk_t {
+    df_listing_t listing;
+    size_t       lines = 0;     // counted from the start of the chunk, from 1
+    std::string  error;
+};
+
+bool
+is_space(char c) {
+    return (c == ' ') || (c == '\t') || (c == '\r');
+}
+
+// Scans one line, returning the reason it is malformed (or nullptr) and the values
+struct line_parser_t {
+    char const * p;
+    char const * end;
+
+    void skip_spaces() {
+        while ((p != end) && is_space(*p)) {
+            ++p;
+        }
+    }
+
+    bool expect(char c) {
+        if ((p == end) || (*p != c)) {
+            return false;
+        }
+        ++p;
+        return true;
+    }
+
+    // decimal digits, returning false if there are none; values that get too big
+    // for 32 bits saturate so the caller can report the overflow
+    bool number(std::uint64_t & value) {
+        char const * start = p;
+        value = 0;
+        while ((p != end) && (*p >= '0') && (*p <= '9')) {
+            value = std::min<std::uint64_t>(value * 10 + (*p - '0'), std::uint64_t(1) << 32);
+            ++p;
+        }
+        return p != start;
+    }
+
+    // a whitespace-separated field of digits followed by "suffix"
+    bool field(std::uint64_t & value, char suffix) {
+        if ((p == end) || !is_space(*p)) {
+            return false;
+        }
+        skip_spaces();
+        return number(value) && expect(suffix);
+    }
+};
+
+char const *
+parse_line(char const * begin, char const * end, server_t & server,
+           server_t::capacity_t & usage, std::string & detail) {
+    using capacity_t = server_t::capacity_t;
+
+    line_parser_t lp{begin + prefix_len, end};
+    std::uint64_t x, y, size, used, avail, percent;
+    if (!(lp.expect('x') && lp.number(x) && lp.expect('-') && lp.expect('y') && lp.number(y))) {
+        return "expected node-x<N>-y<M>";
+    }
+    if (!lp.field(size, 'T')) {
+        return "expected size in T";
+    }
+    if (!lp.field(used, 'T')) {
+        return "expected used space in T";
+    }
+    if (!lp.field(avail, 'T')) {
+        return "expected available space in T";
+    }
+    if (!lp.field(percent, '%')) {
+        return "expected use%";
+    }
+    lp.skip_spaces();
+    if (lp.p != end) {
+        return "unexpected text after use%";
+    }
+
+    constexpr std::uint64_t max_coord = std::numeric_limits<int>::max();
+    if ((x > max_coord) || (y > max_coord)) {
+        return "coordinate out of range";
+    }
+    constexpr std::uint64_t max_capacity = std::numeric_limits<capacity_t>::max();
+    if ((size > max_capacity) || (used > max_capacity)) {
+        detail = std::to_string(std::max(size, used)) + "T exceeds the largest capacity of " +
+                 std::to_string(max_capacity) + "T";
+        return "value too large";
+    }
+    server = server_t{static_cast<int>(x), static_cast<int>(y), static_cast<capacity_t>(size)};
+    usage = static_cast<capacity_t>(used);
+    return nullptr;
+}
+
+// parse whole lines in [begin, end)
+void
+parse_chunk(char const * begin, char const * end, chunk_t & chunk) {
+    for (char const * line = begin; line != end; ) {
+        char const * eol = static_cast<char const *>(memchr(line, '\n', end - line));
+        char const * next = eol ? eol + 1 : end;
+        if (!eol) {
+            eol = end;
+        }
+        ++chunk.lines;
+        if (((eol - line) >= static_cast<std::ptrdiff_t>(prefix_len)) &&
+            (memcmp(line, prefix, prefix_len) == 0)) {
+            server_t server;
+            server_t::capacity_t usage;
+            std::string detail;
+            if (char const * problem = parse_line(line, eol, server, usage, detail)) {
+                chunk.error = detail.empty() ? problem : detail;
+                return;
+            }
+            chunk.listing.servers.push_back(server);
+            chunk.listing.usages.push_back(usage);
+        }
+        line = next;
+    }
+}
+
+}
+
+df_listing_t
+parse_df(char const * begin, char const * end, std::string const& name, size_t threads) {
+    // split at line boundaries, roughly evenly
+    size_t length = end - begin;
+    threads = std::max<size_t>(1, std::min<size_t>(threads, length / 4096 + 1));
+    std::vector<char const *> bounds{begin};
+    for (size_t i = 1; i < threads; ++i) {
+        char const * split = std::max(begin + length * i / threads, bounds.back());
+        char const * eol = static_cast<char const *>(memchr(split, '\n', end - split));
+        bounds.push_back(eol ? eol + 1 : end);
+    }
+    bounds.push_back(end);
+
+    std::vector<chunk_t> chunks(threads);
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads; ++i) {
+        workers.emplace_back(parse_chunk, bounds[i], bounds[i + 1], std::ref(chunks[i]));
+    }
+    parse_chunk(bounds[0], bounds[1], chunks[0]);
+    for (auto & w : workers) {
+        w.join();
+    }
+
+    // report the first error in the file
+    size_t lines_before = 0;
+    for (auto const& c : chunks) {
+        if (!c.error.empty()) {
+            throw parse_error(name + ":" + std::to_string(lines_before + c.lines) + ": " +
+                              c.error);
+        }
+        lines_before += c.lines;
+    }
+
+    if (threads == 1) {
+        return std::move(chunks[0].listing);
+    }
+    df_listing_t listing;
+    size_t total = 0;
+    for (auto const& c : chunks) {
+        total += c.listing.servers.size();
+    }
+    listing.servers.reserve(total);
+    listing.usages.reserve(total);
+    for (auto const& c : chunks) {
+        listing.servers.insert(listing.servers.end(),
+                               c.listing.servers.begin(), c.listing.servers.end());
+        listing.usages.insert(listing.usages.end(),
+                              c.listing.usages.begin(), c.listing.usages.end());
+    }
+    return listing;
+}
+
+df_listing_t
+load_df(std::string const& filename, size_t threads) {
+    mapped_file_t file(filename);
+    return parse_df(file.data(), file.data() + file.size(), filename, threads);
+}
@@ -0,0 +1,34 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+// Loading df output of the form
+//   /dev/grid/node-x0-y0     92T   70T    22T   76%
+// Lines that do not begin with "/dev/grid/node-" (prompts, headers) are ignored.
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "grid.h"
+
+// a malformed line; the message gives the file name and line number
+struct parse_error : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+struct df_listing_t {
+    std::vector<server_t>             servers;
+    std::vector<server_t::capacity_t> usages;     // one per server
+};
+
+// Map the file and parse it in place, splitting it into "threads" chunks parsed
+// concurrently. Servers are listed in file order.
+// Throws parse_error for malformed lines or values too large for capacity_t, and
+// std::system_error if the file cannot be read.
+df_listing_t load_df(std::string const& filename, size_t threads = 1);
+
+// parse text already in memory; "name" is used in error messages
+df_listing_t parse_df(char const * begin, char const * end, std::string const& name,
+                      size_t threads = 1);
+
+#endif // LOADER_H
@@ -2,234 +2,715 @@
 // Jeff Trull <edaskel@att.net>
 
 #include <iostream>
-#include <fstream>
-#include <regex>
 #include <algorithm>
-
-#include <boost/coroutine2/all.hpp>
-#include <boost/graph/astar_search.hpp>
-#include <boost/property_map/property_map.hpp>
-#include <boost/graph/properties.hpp>
-
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include <boost/program_options.hpp>
+
+#include "anytime_search.h"
+#include "arena.h"
+#include "batch_search.h"
+#include "bidirectional_search.h"
+#include "bucket_search.h"
+#include "external_search.h"
 #include "graph.h"
+#include "hda_search.h"
+#include "heuristic.h"
+#include "ida_search.h"
+#include "loader.h"
+#include "mapped_file.h"
+#include "moves.h"
+#include "reduced_graph.h"
+#include "replanner.h"
+#include "search.h"
+#include "service.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "sweep.h"
+#include "viable_pairs.h"
+
+// describe a solution path: as the moves, or as every state along the way
+template<typename Graph, typename Vertex>
+void
+print_solution(std::ostream & os, Graph const& g, std::vector<Vertex> const& soln_path,
+               bool dump_states) {
+    using namespace std;
+    stats::phase_t phase("output");
+    if (dump_states) {
+        os << "solution: " << (soln_path.size() - 1) << " steps to goal state:\n";
+        copy(soln_path.begin(), soln_path.end(),
+             ostream_iterator<Vertex>(os, "\n"));
+        return;
+    }
+    vector<move_t> moves;
+    for (size_t i = 1; i < soln_path.size(); ++i) {
+        moves.push_back(g.move(soln_path[i - 1], soln_path[i]));
+    }
+    write_moves(os, g.grid(), soln_path.front().data_offset(), g.goal(), moves);
+}
 
-struct goal_reached {
-    server_state_t state;
-};
-
-// specialize an astar visitor to detect when we've reached our goal
-struct goal_state_finder : public boost::default_astar_visitor {
+// Answer queries against the loaded grid until the input ends
+template<typename Capacity>
+int
+serve_grid(basic_grid_t<Capacity> const& grid, snapshot_t const * snapshot,
+           boost::program_options::variables_map const& opts) {
+    using namespace std;
 
-    void examine_vertex( server_state_t state, move_graph_t const& g) {
-        if ((g.servers()[state.data_offset()].x == 0) &&
-            (g.servers()[state.data_offset()].y == 0)) {
-            throw goal_reached{state};
+    size_t thread_count = opts["threads"].as<size_t>();
+    if (thread_count == 0) {
+        thread_count = max(1u, thread::hardware_concurrency());
+    }
+    stored_distance_tables_t stored;
+    if (snapshot && snapshot->has_tables()) {
+        stored = snapshot->tables();
+    }
+    try {
+        unique_ptr<basic_solver_service_t<Capacity>> service;
+        {
+            stats::phase_t phase("tables");
+            service.reset(new basic_solver_service_t<Capacity>(
+                grid, thread_count, opts["query-limit"].as<size_t>(),
+                (snapshot && snapshot->has_tables()) ? &stored : nullptr,
+                snapshot ? snapshot->storage() : nullptr));
+        }
+        stats::phase_t phase("serve");
+        if (opts.count("socket")) {
+            string path = opts["socket"].as<string>();
+            cerr << "answering queries on " << path << " with " << thread_count << " threads\n";
+            service->listen(path);
+        } else {
+            service->serve(0, 1);
         }
+    } catch (system_error const& e) {
+        cerr << e.what() << "\n";
+        return 1;
     }
-};
-
-// a heuristic to guide the A* search
-struct server_move_heuristic_t {
-    server_move_heuristic_t(std::vector<server_t> const& servers) : servers_(servers) {}
+    return 0;
+}
 
-    using vertex_t = move_graph_t::vertex_t;
+// Keep a plan up to date through batches of usage changes, one per line of a file,
+// comparing the work each repair takes with planning from scratch
+template<typename Capacity>
+int
+replan_grid(basic_grid_t<Capacity> const& grid, size_t data_start, size_t goal,
+            std::string const& changes_fn) {
+    using namespace std;
 
-    int operator()(const vertex_t& v) const {
+    ifstream changes(changes_fn);
+    if (!changes) {
+        cerr << "cannot open " << changes_fn << "\n";
+        return 1;
+    }
+    unique_ptr<basic_replanner_t<Capacity>> planner;
+    try {
+        stats::phase_t phase("tables");
+        planner.reset(new basic_replanner_t<Capacity>(grid, data_start, goal));
+    } catch (invalid_argument const& e) {
+        cerr << "--replan needs the reduced state space: " << e.what() << "\n";
+        return 1;
+    } catch (length_error const& e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+    auto steps = [](auto const& result) {
+        return result.found() ? to_string(result.path.size() - 1) + " steps" :
+                                string("no solution");
+    };
+    auto result = [&]() {
+        stats::phase_t phase("search");
+        return planner->plan();
+    }();
+    cout << "initial plan: " << steps(result) << ", " << result.examined
+         << " vertices examined\n";
+
+    string line;
+    size_t batch = 0;
+    while (getline(changes, line)) {
+        if (line.find_first_not_of(" \t\r") == string::npos) {
+            continue;
+        }
+        ++batch;
+        try {
+            stats::phase_t phase("tables");
+            planner->update(parse_server_changes(line, planner->grid()));
+        } catch (exception const& e) {
+            // the planner is as it was
+            cout << "batch " << batch << ": error: " << e.what() << "\n";
+            continue;
+        }
+        result = [&]() {
+            stats::phase_t phase("search");
+            return planner->plan();
+        }();
+        auto fresh = [&]() {
+            stats::phase_t phase("resolve");
+            return basic_replanner_t<Capacity>(planner->grid(), data_start, goal).plan();
+        }();
+        cout << "batch " << batch << ": " << steps(result) << ", " << result.examined
+             << " vertices examined (" << result.reexpanded << " re-expanded"
+             << (planner->restarted() ? ", after starting over" : "") << "); "
+             << fresh.examined << " planning from scratch\n";
+        if (steps(result) != steps(fresh)) {
+            cerr << "batch " << batch << ": planning from scratch gives " << steps(fresh) << "\n";
+            return 1;
+        }
+    }
+    if (result.found()) {
+        print_solution(cout, planner->reduced_graph(), result.path, false);
+    }
+    return 0;
+}
 
-        // Heuristic plan:
-        // We need enough steps to move the original data to the origin
-        // That ends up being about 5 times the Manhattan distance due to the need to move
-        // the "blank tile" (server with sufficient capacity) back into place between the
-        // target data and the origin each time.
-        // In addition, we need to move the "blank tile" into position in the first place.
+// Everything after loading, for a grid with capacity lanes of either width
+template<typename Capacity>
+int
+solve_grid(basic_grid_t<Capacity> const& grid, snapshot_t const * snapshot,
+           boost::program_options::variables_map const& opts) {
+    using namespace std;
 
-        // Manhattan distance to goal
-        // we must make at least this many moves to get the original data home
-        server_t current_server = servers_[v.data_offset()];
-        int mdist = current_server.x + current_server.y;
+    if (opts.count("serve")) {
+        return serve_grid(grid, snapshot, opts);
+    }
 
-        // if mdist is 0, we are at the target, so simply return 0
-        if (mdist == 0) {
-            return 0;
+    // the target data starts at the upper right corner and goes to the origin, unless
+    // we are told otherwise
+    size_t data_start = grid.offset(grid.width() - 1, 0);
+    size_t goal = 0;
+    for (char const * name : {"from", "to"}) {
+        if (!opts.count(name)) {
+            continue;
         }
-
-        // Finding the distance to the "blank tile"
-        // First, find the nearest (to the origin) server of sufficient reserve capacity
-        // to hold the target data
-
-        std::vector<server_t> eligible_servers;
-        for (size_t i = 0; i < servers_.size(); ++i) {
-            if ((servers_[i].capacity - v.usage(i)) >= v.usage(v.data_offset())) {
-                eligible_servers.push_back(servers_[i]);
+        string server = opts[name].as<string>();
+        size_t offset;
+        try {
+            if (parse_server(server.c_str(), grid, offset) != server.size()) {
+                cerr << "--" << name << " needs a server such as node-x1-y0, not "
+                     << server << "\n";
+                return 1;
             }
+        } catch (invalid_move const& e) {
+            cerr << "--" << name << ": " << e.what() << "\n";
+            return 1;
         }
-        // take the one with the minimum Manhattan distance to the server with our data
-        auto min_it = min_element(eligible_servers.begin(), eligible_servers.end(),
-                                  [&current_server](server_t const& a, server_t const& b) {
-                                      return ((abs(current_server.x - a.x) + abs(current_server.y - a.y)) <
-                                              (abs(current_server.x - b.x) + abs(current_server.y - b.y)));
-                                  });
-        assert(min_it != eligible_servers.end());   // insoluble!
-
-        // calculate distance to point above or to left of target data, whichever is shorter
-        int hole_dist = std::numeric_limits<int>::max();
-        if (current_server.y > 0) {
-            // distance to point above target
-            hole_dist = abs((current_server.y - 1) - min_it->y) + abs(current_server.x - min_it->x);
+        (string(name) == "from" ? data_start : goal) = offset;
+    }
+    if (opts.count("replan")) {
+        return replan_grid(grid, data_start, goal, opts["replan"].as<string>());
+    }
+    basic_move_graph_t<Capacity> move_graph(grid, data_start, goal);
+
+    // Precomputed distances come with the snapshot, if it has them. They are for the
+    // origin; another goal shares their hole distances and builds its own goal tables.
+    unique_ptr<basic_distance_tables_t<Capacity>> loaded, tables;
+    {
+        stats::phase_t phase("tables");
+        if (snapshot && snapshot->has_tables()) {
+            loaded.reset(new basic_distance_tables_t<Capacity>(move_graph, snapshot->tables(),
+                                                               snapshot->storage()));
+            if (goal == 0) {
+                tables = std::move(loaded);
+            } else {
+                tables.reset(new basic_distance_tables_t<Capacity>(move_graph, *loaded));
+            }
+        } else if (!opts.count("compile") || !opts.count("no-tables")) {
+            tables.reset(new basic_distance_tables_t<Capacity>(move_graph));
         }
-        if (current_server.x > 0) {
-            // distance to point left of target
-            hole_dist = std::min(hole_dist,
-                                 abs((current_server.x - 1) - min_it->x) + abs(current_server.y - min_it->y));
+    }
+
+    if (opts.count("compile")) {
+        string output_fn = opts["output"].as<string>();
+        try {
+            write_snapshot(output_fn, grid, tables.get());
+        } catch (snapshot_error const& e) {
+            cerr << e.what() << "\n";
+            return 1;
         }
+        cout << "wrote " << grid.width() << "x" << grid.height() << " grid ("
+             << (8 * sizeof(Capacity)) << "-bit capacities) "
+             << (tables ? "with" : "without") << " distance tables to " << output_fn << "\n";
+        return 0;
+    }
 
-        // each move of the target data requires 5 moves overall, except for the last one
-        return (5*(mdist-1)+ 1) + hole_dist;
+    // why the reduced state space cannot be used, or empty if it can. A grid with too
+    // many holes still has the reduced space's moves, and the heuristics that rely on
+    // them, but its holes do not fit in a reduced_state_t.
+    string reduced_problem = move_graph.abstraction_problem();
+    if (reduced_problem.empty() && (move_graph.holes().size() > reduced_state_t::max_holes)) {
+        reduced_problem = to_string(move_graph.holes().size()) +
+                          " empty servers, more than the reduced state holds";
     }
 
-private:
+    if (opts.count("all-starts")) {
+        if (!reduced_problem.empty()) {
+            cerr << "--all-starts needs the reduced state space: " << reduced_problem << "\n";
+            return 1;
+        }
+        basic_reduced_move_graph_t<Capacity> reduced_graph(move_graph);
+        vector<uint32_t> costs;
+        try {
+            stats::phase_t phase("search");
+            costs = relocation_costs(reduced_graph, size_t(1) << 24);
+        } catch (length_error const& e) {
+            cerr << e.what() << "\n";
+            return 1;
+        }
+        stats::phase_t phase("output");
+        write_relocation_costs(cout, move_graph, costs);
+        return 0;
+    }
 
-    std::vector<server_t> const & servers_;
+    basic_server_state_t<Capacity> initial_state = move_graph.initial_state();
 
-};
+    // now see how many viable pairs there are
+    {
+        stats::phase_t phase("viable_pairs");
+        if (opts.count("list-pairs")) {
+            for (auto const& p : basic_viable_pair_range_t<Capacity>(grid)) {
+                cout << "node-x" << grid.x(p.first) << "-y" << grid.y(p.first) << " -> "
+                     << "node-x" << grid.x(p.second) << "-y" << grid.y(p.second) << "\n";
+            }
+        }
+        size_t viable_pair_count = count_viable_pairs(grid);
 
-int main(int argc, char **argv) {
-    using namespace std;
+        cout << viable_pair_count << " viable pairs\n";
+    }
 
-    if (argc != 2) {
-        cerr << "usage: day22 input.txt\n";
+    // next, find a sequence of moves of data that will result in the data in the
+    // upper right being in the upper left
+
+    string heuristic_name = opts["heuristic"].as<string>();
+    if ((heuristic_name != "tables") && (heuristic_name != "manhattan")) {
+        cerr << "unknown heuristic " << heuristic_name << "\n";
         return 1;
     }
+    basic_server_move_heuristic_t<Capacity> table_heuristic(move_graph, *tables);
+    basic_manhattan_move_heuristic_t<Capacity> manhattan_heuristic(grid, move_graph.goal());
 
-    ifstream input(argv[1]);
-    if (!input.is_open()) {
-        cerr << "error opening " << argv[1] << "\n";
+    string engine = opts["engine"].as<string>();
+    if ((engine != "astar") && (engine != "bucket") && (engine != "ida") &&
+        (engine != "anytime") && (engine != "external") && (engine != "batch")) {
+        cerr << "unknown engine " << engine << "\n";
+        return 1;
+    }
+    double weight = opts["weight"].as<double>();
+    double weight_step = opts["weight-step"].as<double>();
+    if ((weight < 1.0) || (weight_step <= 0.0)) {
+        cerr << "--weight must be at least 1 and --weight-step more than 0\n";
+        return 1;
+    }
+    auto time_budget = chrono::duration_cast<chrono::steady_clock::duration>(
+        chrono::duration<double>(opts["time-budget"].as<double>()));
+    size_t table_bytes = opts["table-mb"].as<size_t>() << 20;
+    size_t ram_bytes = opts["ram-mb"].as<size_t>() << 20;
+    string spill_dir = opts.count("spill-dir") ? opts["spill-dir"].as<string>() :
+                       getenv("TMPDIR") ? string(getenv("TMPDIR")) : string("/tmp");
+
+    string direction = opts["direction"].as<string>();
+    if ((direction != "uni") && (direction != "bi")) {
+        cerr << "unknown direction " << direction << "\n";
+        return 1;
+    }
+    if ((direction == "bi") && ((engine != "astar") || (opts["threads"].as<size_t>() != 1))) {
+        cerr << "bidirectional search runs its own engine on one thread; "
+                "it cannot take --engine or --threads\n";
         return 1;
     }
 
-    regex df_re(R"(^/dev/grid/node-x(\d+)-y(\d+)\s+(\d+)T\s+(\d+)T\s.*)");
-    vector<server_t> servers;
-    using capacity_t = server_t::capacity_t;
-    std::vector<capacity_t> usages;
-    while (!input.eof()) {
-        string instr;
-        getline(input, instr);
-        match_results<string::iterator> matches;
-        if (regex_match(instr.begin(), instr.end(), matches, df_re)) {
-            // collect info on this server
-            int capacity = stoi(matches.str(3));
-            assert(capacity <= std::numeric_limits<capacity_t>::max());
-            servers.push_back({
-                    stoi(matches.str(1)),
-                    stoi(matches.str(2)),
-                    static_cast<capacity_t>(capacity)});
-            int usage = stoi(matches.str(4));
-            assert(usage <= std::numeric_limits<capacity_t>::max());
-            usages.push_back(usage);
-        }        
-    }        
-    move_graph_t move_graph(servers);
+    size_t thread_count = opts["threads"].as<size_t>();
+    if (thread_count == 0) {
+        thread_count = max(1u, thread::hardware_concurrency());
+    }
+
+    // States and search records come from one arena, freed together once the solution
+    // has been printed
+    search_arena_t arena;
+    arena_scope_t use_arena(opts.count("no-arena") ? nullptr : &arena);
+
+    // search with one thread or many, or in bounded memory
+    auto search = [&](auto const& graph, auto const& start, auto const& heuristic) {
+        if (opts.count("compare-engines")) {
+            auto begin = chrono::steady_clock::now();
+            auto with_boost = astar_solve(graph, start, heuristic);
+            auto middle = chrono::steady_clock::now();
+            auto with_buckets = bucket_solve(graph, start, heuristic);
+            chrono::duration<double> boost_time = middle - begin;
+            chrono::duration<double> bucket_time = chrono::steady_clock::now() - middle;
+            cout << "boost a*:  " << with_boost.examined << " vertices examined in "
+                 << boost_time.count() << "s\n";
+            cout << "bucket a*: " << with_buckets.examined << " vertices examined in "
+                 << bucket_time.count() << "s\n";
+            if (with_boost.path.size() != with_buckets.path.size()) {
+                throw runtime_error("engines disagree on solution length");
+            }
+            return with_buckets;
+        }
+        if (engine == "bucket") {
+            return bucket_solve(graph, start, heuristic);
+        }
+        if (engine == "batch") {
+            size_t batch = opts["batch-size"].as<size_t>();
+            work_pool_t pool(thread_count);
+            auto begin = chrono::steady_clock::now();
+            auto result = batch_solve(graph, start, heuristic, batch, pool);
+            chrono::duration<double> elapsed = chrono::steady_clock::now() - begin;
+            cout << thread_count << " threads, batches of " << batch << ": " << result.examined
+                 << " vertices examined in " << elapsed.count() << "s ("
+                 << static_cast<size_t>(result.examined / elapsed.count()) << "/s, "
+                 << pool.steals() << " shares stolen)\n";
+            return result;
+        }
+        if (engine == "anytime") {
+            // report each better solution as it turns up, on standard error so that
+            // standard output holds just the final one, for d22_verify
+            auto begin = chrono::steady_clock::now();
+            auto elapsed = [begin]() {
+                return chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+            };
+            auto result = anytime_solve(graph, start, heuristic, weight, weight_step, time_budget,
+                                        [&](auto const& r) {
+                cout << "anytime: " << r.upper_bound << " steps at weight " << r.weight
+                     << ", lower bound " << r.lower_bound << " (" << elapsed() << "s)" << endl;
+                print_solution(cerr, graph, r.path, opts.count("dump-states"));
+                cerr << flush;
+            });
+            cout << "anytime: " << result.iterations << " iterations, " << result.examined
+                 << " vertices examined in " << elapsed() << "s; ";
+            if (!result.found()) {
+                cout << (result.timed_out ? "out of time\n" : "no solution\n");
+            } else if (result.lower_bound == result.upper_bound) {
+                cout << result.upper_bound << " steps is optimal\n";
+            } else {
+                cout << "out of time with " << result.upper_bound << " steps, at least "
+                     << result.lower_bound << " needed (gap " << (result.upper_bound -
+                     result.lower_bound) << ")\n";
+            }
+            using vertex_t = typename decltype(result.path)::value_type;
+            return static_cast<search_result_t<vertex_t>>(result);
+        }
+        if (engine == "external") {
+            // spill file errors are system_errors, reported by solve_and_print
+            auto result = external_solve(graph, start, heuristic, ram_bytes, spill_dir);
+            cout << "external: " << result.iterations << " iterations, up to "
+                 << result.layers << " layers, " << result.examined
+                 << " vertices examined; " << result.runs << " runs and "
+                 << (result.bytes_written >> 20) << " MiB written\n";
+            using vertex_t = typename decltype(result.path)::value_type;
+            return static_cast<search_result_t<vertex_t>>(result);
+        }
+        if (engine == "ida") {
+            auto result = ida_solve(graph, start, heuristic, table_bytes);
+            cout << "ida*: " << result.iterations << " iterations, " << result.examined
+                 << " vertices examined (" << result.reexpanded << " re-expanded)\n";
+            return result;
+        }
+        if (thread_count == 1) {
+            return astar_solve(graph, start, heuristic);
+        }
+        auto begin = chrono::steady_clock::now();
+        auto result = hda_solve(graph, start, heuristic, thread_count);
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - begin;
+        cout << thread_count << " threads: " << result.examined << " vertices examined in "
+             << elapsed.count() << "s (" << static_cast<size_t>(result.examined / elapsed.count())
+             << "/s); per thread:";
+        for (size_t n : result.examined_per_thread) {
+            cout << " " << n;
+        }
+        cout << "\n";
+        return result;
+    };
 
-    server_state_t   initial_state(move_graph.ur_corner(),
-                                   usages.begin(), usages.end());
+    // run the search on the chosen graph with the chosen heuristic
+    auto solve = [&](auto const& graph, auto const& start) {
+        stats::phase_t phase("search");
+        if (opts.count("compare-heuristics")) {
+            auto with_manhattan = search(graph, start, manhattan_heuristic);
+            auto with_tables = search(graph, start, table_heuristic);
+            cout << "manhattan heuristic: " << with_manhattan.examined << " vertices examined\n";
+            cout << "table heuristic:     " << with_tables.examined << " vertices examined ("
+                 << (static_cast<long>(with_manhattan.examined) -
+                     static_cast<long>(with_tables.examined)) << " fewer)\n";
+            return with_tables;
+        }
+        if (heuristic_name == "manhattan") {
+            return search(graph, start, manhattan_heuristic);
+        }
+        return search(graph, start, table_heuristic);
+    };
 
-    // now see how many viable pairs there are
-    // create a generator from the pair calculation:
-
-    using namespace boost::coroutines2;
-    using viable_pair_coro_t = boost::coroutines2::coroutine<std::pair<int, int>>;
-    auto viable_pair_generator =
-        [&](viable_pair_coro_t::push_type & sink) {
-        // faster way is to sort by capacity but this is good enough for now
-        for (size_t i = 0; i < servers.size(); ++i) {
-            for (size_t j = 0; j < servers.size(); ++j) {
-                if (initial_state.usage(i) == 0) {
-                    continue;
-                }
+    // Errors during the search are thrown rather than exiting, so the arena, spill
+    // files and stats report are cleaned up on the way out
+    auto solve_and_print = [&](auto const& graph, auto const& start) {
+        try {
+            auto result = solve(graph, start);
+            if (result.found()) {
+                print_solution(cout, graph, result.path, opts.count("dump-states"));
+                return 0;
+            }
+        } catch (runtime_error const& e) {
+            cerr << e.what() << "\n";
+            return 1;
+        }
+        cerr << "could not find solution\n";
+        return 1;
+    };
 
-                if (i == j) {
-                    continue;
+    if (!opts.count("full-state")) {
+        if (reduced_problem.empty()) {
+            // equivalent problem with a far smaller state
+            basic_reduced_move_graph_t<Capacity> reduced_graph(move_graph);
+            if (direction == "bi") {
+                vector<reduced_state_t> goals;
+                try {
+                    goals = reduced_graph.goal_states(size_t(1) << 24);
+                } catch (length_error const& e) {
+                    cerr << e.what() << "\n";
+                    return 1;
                 }
-
-                if (initial_state.usage(i) <= (servers[j].capacity - initial_state.usage(j))) {
-                    // room to move there, if there is a path
-                    sink(make_pair(i, j));
+                basic_reverse_move_heuristic_t<Capacity> reverse_heuristic(reduced_graph, *tables);
+                auto result = [&]() {
+                    stats::phase_t phase("search");
+                    return (heuristic_name == "manhattan") ?
+                        bidirectional_solve(reduced_graph, reduced_graph.initial_state(), goals,
+                                            manhattan_heuristic, reverse_heuristic) :
+                        bidirectional_solve(reduced_graph, reduced_graph.initial_state(), goals,
+                                            table_heuristic, reverse_heuristic);
+                }();
+                cout << "bidirectional: " << (result.examined - result.examined_backward)
+                     << " vertices examined forward, " << result.examined_backward
+                     << " backward from " << goals.size() << " goal states\n";
+                if (result.found()) {
+                    print_solution(cout, reduced_graph, result.path, opts.count("dump-states"));
+                    return 0;
                 }
+                cerr << "could not find solution\n";
+                return 1;
             }
-        }};
-
-    // create a sequence from the generator
-    viable_pair_coro_t::pull_type viable_pairs(viable_pair_generator);
-
-    // count pairs in sequence
-    size_t viable_pair_count = 0;
-    for (auto const& v : viable_pairs) {
-        (void)v;
-        ++viable_pair_count;
+            return solve_and_print(reduced_graph, reduced_graph.initial_state());
+        }
+        cerr << "using full state space: " << reduced_problem << "\n";
+    }
+    if (direction == "bi") {
+        cerr << "bidirectional search needs the reduced state space\n";
+        return 1;
     }
 
-    cout << viable_pair_count << " viable pairs\n";
+    return solve_and_print(move_graph, initial_state);
+}
 
-    // next, find a sequence of moves of data that will result in the data in the
-    // upper right being in the upper left
+int main(int argc, char **argv) {
+    using namespace std;
 
-    // requirements for A* search
-    using vertex_t = move_graph_t::vertex_t;
-    map<vertex_t, size_t> vertex_index_map;
-    map<vertex_t, size_t> rank_map;
-    map<vertex_t, boost::default_color_type> color_map;
-    map<vertex_t, vertex_t> predecessor_map;  // results (path) storage
-    // the distance map needs to default to a large number instead of 0
-    // because initially all vertices have unknown paths to them
-    map<vertex_t, size_t> distance_map;
-    auto distance_lookup =
-        [&distance_map](vertex_t const& v) -> size_t& {
-        if (distance_map.find(v) == distance_map.end()) {
-            distance_map[v] = numeric_limits<size_t>::max();
-        }
-        return distance_map[v];
-    };
-    auto distance_pmap =
-        boost::make_function_property_map<vertex_t, size_t&, decltype(distance_lookup)>(
-            distance_lookup);
+    namespace po = boost::program_options;
+    po::options_description visible("usage: day22 [options] input.txt\n"
+                                    "       day22 --compile input.txt out.bin\n"
+                                    "       day22 --serve [--socket path] input.txt\noptions");
+    visible.add_options()
+        ("help,h", "show this message")
+        ("list-pairs", "list each viable pair before counting them")
+        ("dump-states", "print every state along the solution instead of the moves")
+        ("parse-threads", po::value<size_t>()->default_value(1),
+         "threads for parsing the input (0 for all cores)")
+        ("capacity", po::value<string>()->default_value("auto"),
+         "width of the capacity lanes: \"16\" or \"32\" bits, or \"auto\" for the "
+         "narrowest that holds every capacity")
+        ("compile", "save the input as a binary snapshot, which loads without parsing")
+        ("no-tables", "with --compile, leave the precomputed distance tables out")
+        ("full-state", "search over full server usages even when the reduced "
+                       "(hole + data) state space is equivalent")
+        ("heuristic", po::value<string>()->default_value("tables"),
+         "A* heuristic: \"tables\" (precomputed wall-aware distances) or "
+         "\"manhattan\" (the original estimate)")
+        ("compare-heuristics", "solve with both heuristics and report vertices examined")
+        ("threads", po::value<size_t>()->default_value(1),
+         "search threads; more than one uses hash-distributed A* (0 for all cores). "
+         "With --engine batch, threads expanding each batch. "
+         "With --serve, threads answering queries")
+        ("engine", po::value<string>()->default_value("astar"),
+         "search engine: \"astar\", \"bucket\" (A* with an open list bucketed by f), "
+         "\"ida\" (iterative deepening A*, for state spaces too large to keep in memory; "
+         "it revisits states many times, so even small grids with several empty servers "
+         "can take far longer than with astar), "
+         "\"anytime\" (weighted A*, improving its solution as the weight falls; each "
+         "better solution is printed to standard error as it is found), "
+         "\"external\" (breadth-first iterative deepening, keeping its layers in files), "
+         "or \"batch\" (A* expanding the best states in batches across --threads)")
+        ("batch-size", po::value<size_t>()->default_value(64),
+         "with --engine batch, states expanded together each round")
+        ("weight", po::value<double>()->default_value(3.0),
+         "with --engine anytime, the first iteration's heuristic weight")
+        ("weight-step", po::value<double>()->default_value(0.5),
+         "with --engine anytime, how much the weight falls each iteration")
+        ("time-budget", po::value<double>()->default_value(10.0),
+         "with --engine anytime, seconds to spend improving the solution")
+        ("direction", po::value<string>()->default_value("uni"),
+         "\"uni\", or \"bi\" to also search backward from every goal state "
+         "(reduced state space only, and only with the default --engine and --threads)")
+        ("compare-engines", "time the Boost.Graph A* search against the bucket-queue engine")
+        ("table-mb", po::value<size_t>()->default_value(64),
+         "transposition table size for --engine=ida, in MiB")
+        ("ram-mb", po::value<size_t>()->default_value(256),
+         "buffer for the next layer with --engine=external, in MiB")
+        ("spill-dir", po::value<string>(), "where --engine=external puts its files "
+                                           "(default: $TMPDIR, or /tmp)")
+        ("no-arena", "allocate states and search records from the heap one at a time, "
+                     "rather than from an arena freed when the search is done")
+        ("stats", "on exit, report time per phase and search counters to standard error")
+        ("stats-format", po::value<string>()->default_value("text"),
+         "with --stats, \"text\" or \"json\"")
+        ("progress", "report search progress to standard error now and then")
+        ("progress-interval", po::value<double>()->default_value(1.0),
+         "with --progress, seconds between reports")
+        ("serve", "keep running, answering queries read one per line from standard input: "
+                  "usage changes such as \"node-x1-y2=0\", \"from\" and \"to\" servers, "
+                  "and \"moves\" to list the moves")
+        ("socket", po::value<string>(), "with --serve, take queries from connections to a "
+                                        "Unix socket created at this path")
+        ("query-limit", po::value<size_t>()->default_value(1000000),
+         "with --serve, vertices a search may examine before giving up (0 for no limit)")
+        ("from", po::value<string>(), "server the target data starts on (default: the "
+                                      "upper right corner)")
+        ("to", po::value<string>(), "server the target data must reach (default: node-x0-y0)")
+        ("all-starts", "print the fewest moves to the goal from every server at once, "
+                       "found by one search backward from the goal")
+        ("replan", po::value<string>(), "plan, then repair the plan after each batch of usage "
+                                        "changes (a line like \"node-x1-y2=0 node-x3-y0=70/90\") "
+                                        "in this file, comparing the work with starting afresh");
+    po::options_description all;
+    all.add(visible).add_options()
+        ("input", po::value<string>()->required(), "df output or snapshot to solve")
+        ("output", po::value<string>(), "snapshot to write");
+    po::positional_options_description positional;
+    positional.add("input", 1).add("output", 1);
+
+    po::variables_map opts;
+    try {
+        po::store(po::command_line_parser(argc, argv).
+                  options(all).positional(positional).run(), opts);
+        if (opts.count("help")) {
+            cout << visible;
+            return 0;
+        }
+        po::notify(opts);
+    } catch (po::error const& e) {
+        cerr << e.what() << "\n" << visible;
+        return 1;
+    }
 
-    // set up initial state
-    distance_map[initial_state] = 0;
-    predecessor_map[initial_state] = initial_state;
+    string input_fn = opts["input"].as<string>();
 
-    using namespace boost;
-    try {
-        // no_init is the appropriate variant for implicit graphs like ours
-        astar_search_no_init(
-            move_graph,
-            initial_state,
-            server_move_heuristic_t(servers),
-            // named params
-            weight_map(make_static_property_map<vertex_t, size_t>(1)).
-            vertex_index_map(associative_property_map<map<vertex_t, size_t>>(vertex_index_map)).
-            rank_map(associative_property_map<map<vertex_t, size_t>>(rank_map)).
-            distance_map(distance_pmap).
-            color_map(associative_property_map<map<vertex_t, default_color_type>>(color_map)).
-            visitor(goal_state_finder()).
-            predecessor_map(associative_property_map<map<vertex_t, vertex_t>>(predecessor_map))
-            );
-    } catch (goal_reached const& e) {
-        // reverse path for display
-        vector<server_state_t> soln_path;
-        auto next_state = e.state;
-        do {
-            soln_path.push_back(next_state);
-            next_state = predecessor_map[next_state];
-        } while (!(soln_path.back() == next_state));
-        reverse(soln_path.begin(), soln_path.end());
-
-        // describe the path
-        cout << "solution: " << (soln_path.size() - 1) << " steps to goal state:\n";
-        copy(soln_path.begin(), soln_path.end(),
-                  ostream_iterator<server_state_t>(cout, "\n"));
+    // report statistics however main exits
+    struct stats_report_t {
+        string format;
+        ~stats_report_t() {
+            if (format == "json") {
+                stats::write_json(cerr);
+            } else if (!format.empty()) {
+                stats::write_text(cerr);
+            }
+        }
+    } stats_report;
+    if (opts.count("stats")) {
+        stats_report.format = opts["stats-format"].as<string>();
+        if ((stats_report.format != "text") && (stats_report.format != "json")) {
+            cerr << "unknown stats format " << stats_report.format << "\n";
+            stats_report.format.clear();
+            return 1;
+        }
+    }
+    if (opts.count("progress")) {
+        if (!D22_STATS) {
+            cerr << "--progress needs a build configured with -DD22_STATS=ON\n";
+            return 1;
+        }
+        stats::enable_progress(opts["progress-interval"].as<double>());
+    }
+    if (opts.count("socket") && !opts.count("serve")) {
+        cerr << "--socket needs --serve\n";
+        return 1;
+    }
+    if (opts.count("to") && opts.count("compile")) {
+        cerr << "snapshot distance tables are for node-x0-y0; --to cannot be compiled in\n";
+        return 1;
+    }
+    if (opts.count("compile") != opts.count("output")) {
+        cerr << "--compile takes an input and an output file\n" << visible;
+        return 1;
+    }
 
-        return 0;
+    // snapshots are used in place; df output is parsed
+    unique_ptr<snapshot_t> snapshot;
+    df_listing_t listing;
+    unsigned needed_bits = [&]() -> unsigned {
+        stats::phase_t phase("load");
+        try {
+            auto file = make_shared<mapped_file_t>(input_fn);
+            if (is_snapshot(file->data(), file->size())) {
+                snapshot.reset(new snapshot_t(file, input_fn));
+                return snapshot->capacity_bits();
+            }
+            size_t parse_threads = opts["parse-threads"].as<size_t>();
+            if (parse_threads == 0) {
+                parse_threads = max(1u, thread::hardware_concurrency());
+            }
+            listing = parse_df(file->data(), file->data() + file->size(),
+                               input_fn, parse_threads);
+            if (listing.servers.empty()) {
+                cerr << "no servers found in " << input_fn << "\n";
+                return 0;
+            }
+            return capacity_bits(listing.servers);
+        } catch (std::runtime_error const& e) {
+            // parse, snapshot and system errors already name the file
+            cerr << e.what() << "\n";
+            return 0;
+        }
+    }();
+    if (needed_bits == 0) {
+        return 1;                       // already reported
+    }
+
+    // Use the narrowest capacity lanes the grid fits in, unless told otherwise. A
+    // snapshot's lanes are fixed when it is written.
+    string capacity = opts["capacity"].as<string>();
+    if ((capacity != "auto") && (capacity != "16") && (capacity != "32")) {
+        cerr << "unknown capacity width " << capacity << "\n";
+        return 1;
+    }
+    unsigned bits = (capacity == "auto") ? needed_bits : stoul(capacity);
+    if (snapshot && (bits != needed_bits)) {
+        cerr << input_fn << ": snapshot has " << needed_bits << "-bit capacities\n";
+        return 1;
+    }
+    if (bits < needed_bits) {
+        cerr << input_fn << ": capacities need " << needed_bits << "-bit lanes\n";
+        return 1;
+    }
+    auto load_and_solve = [&](auto capacity_type) {
+        using grid_type = basic_grid_t<decltype(capacity_type)>;
+        unique_ptr<grid_type> grid;
+        {
+            stats::phase_t phase("load");
+            try {
+                grid.reset(snapshot ? new grid_type(snapshot->grid<decltype(capacity_type)>())
+                                    : new grid_type(listing.servers, listing.usages));
+            } catch (std::invalid_argument const& e) {
+                cerr << input_fn << ": " << e.what() << "\n";
+                return 1;
+            } catch (std::runtime_error const& e) {
+                cerr << e.what() << "\n";
+                return 1;
+            }
+        }
+        return solve_grid(*grid, snapshot.get(), opts);
+    };
+    if (bits == 16) {
+        return load_and_solve(std::int16_t());
     }
-    cerr << "could not find solution\n";
-    return 1;
+    return load_and_solve(std::int32_t());
 }
@@ -0,0 +1,92 @@
+// Read-only file mappings for Advent of Code, Day 22
+
+#include "mapped_file.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+mapped_file_t::mapped_file_t(std::string const& filename)
+    : data_(nullptr), size_(0), mapped_(false), copy_(nullptr) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "error opening " + filename);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        close(fd);
+        throw std::system_error(err, std::generic_category(), "error reading " + filename);
+    }
+    if (!S_ISREG(st.st_mode)) {
+        std::vector<char> contents;
+        char buffer[65536];
+        for (;;) {
+            ssize_t got = read(fd, buffer, sizeof(buffer));
+            if (got < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                int err = errno;
+                close(fd);
+                throw std::system_error(err, std::generic_category(), "error reading " + filename);
+            }
+            if (got == 0) {
+                break;
+            }
+            contents.insert(contents.end(), buffer, buffer + got);
+        }
+        close(fd);
+        // aligned like a mapping would be, so snapshot lanes can be used in place
+        size_ = contents.size();
+        if (size_ != 0) {
+            copy_ = static_cast<char *>(aligned_alloc(copy_alignment,
+                                                      (size_ + copy_alignment - 1) /
+                                                      copy_alignment * copy_alignment));
+            if (!copy_) {
+                throw std::bad_alloc();
+            }
+            std::memcpy(copy_, contents.data(), size_);
+            data_ = copy_;
+        }
+        return;
+    }
+    size_ = st.st_size;
+    if (size_ != 0) {
+        void * p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            int err = errno;
+            close(fd);
+            throw std::system_error(err, std::generic_category(), "error mapping " + filename);
+        }
+        madvise(p, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<char const *>(p);
+        mapped_ = true;
+    }
+    close(fd);      // the mapping stays valid
+}
+
+mapped_file_t::~mapped_file_t() {
+    if (mapped_) {
+        munmap(const_cast<char *>(data_), size_);
+    }
+    free(copy_);
+}
+
+char const *
+mapped_file_t::data() const {
+    return data_;
+}
+
+size_t
+mapped_file_t::size() const {
+    return size_;
+}
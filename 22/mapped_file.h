@@ -0,0 +1,31 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+// A read-only memory mapping of an entire file, released on destruction
+// Pipes and other files that cannot be mapped are read into memory instead, aligned to
+// copy_alignment bytes so that snapshot lanes in them can be used in place.
+
+#include <cstddef>
+#include <string>
+
+struct mapped_file_t {
+    static constexpr size_t copy_alignment = 64;
+
+    // throws std::system_error if the file cannot be opened or mapped
+    explicit mapped_file_t(std::string const& filename);
+    ~mapped_file_t();
+
+    mapped_file_t(mapped_file_t const&) = delete;
+    mapped_file_t& operator=(mapped_file_t const&) = delete;
+
+    char const * data() const;
+    size_t       size() const;
+
+private:
+    char const *      data_;     // null for an empty file
+    size_t            size_;
+    bool              mapped_;
+    char *            copy_;     // contents, if not mapped (from aligned_alloc)
+};
+
+#endif // MAPPED_FILE_H
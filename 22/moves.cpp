@@ -0,0 +1,178 @@
+// Move list output and replay for Advent of Code, Day 22
+
+#include "moves.h"
+
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+
+namespace {
+
+// nothing but whitespace from "pos" on
+bool
+blank_from(std::string const& line, size_t pos) {
+    return line.find_first_not_of(" \t\r", pos) == std::string::npos;
+}
+
+}
+
+template<typename Capacity>
+std::string
+server_name(basic_grid_t<Capacity> const& grid, size_t offset) {
+    return "node-x" + std::to_string(grid.x(offset)) + "-y" + std::to_string(grid.y(offset));
+}
+
+template<typename Capacity>
+size_t
+parse_server(char const * text, basic_grid_t<Capacity> const& grid, size_t & offset) {
+    int x, y;
+    int end = 0;
+    if ((sscanf(text, "node-x%d-y%d%n", &x, &y, &end) != 2) || (end == 0)) {
+        return 0;
+    }
+    if ((x < 0) || (y < 0) ||
+        (static_cast<size_t>(x) >= grid.width()) || (static_cast<size_t>(y) >= grid.height())) {
+        throw invalid_move("server outside the grid: " + std::string(text, end));
+    }
+    offset = grid.offset(x, y);
+    return end;
+}
+
+template<typename Capacity>
+void
+write_moves(std::ostream & os, basic_grid_t<Capacity> const& grid,
+            size_t data_start, size_t goal, std::vector<move_t> const& moves) {
+    os << "solution: " << moves.size() << " steps from " << server_name(grid, data_start)
+       << " to " << server_name(grid, goal) << ":\n";
+    for (auto const& m : moves) {
+        os << server_name(grid, m.src) << " -> " << server_name(grid, m.dst) << "\n";
+    }
+}
+
+template<typename Capacity>
+bool
+parse_move(std::string const& line, basic_grid_t<Capacity> const& grid, move_t & move) {
+    int sx, sy, dx, dy;
+    int end = 0;
+    if ((sscanf(line.c_str(), "node-x%d-y%d -> node-x%d-y%d%n", &sx, &sy, &dx, &dy, &end) != 4) ||
+        (end == 0) || !blank_from(line, end)) {
+        return false;
+    }
+    auto offset = [&grid, &line](int x, int y) {
+        if ((x < 0) || (y < 0) ||
+            (static_cast<size_t>(x) >= grid.width()) || (static_cast<size_t>(y) >= grid.height())) {
+            throw invalid_move("server outside the grid: " + line);
+        }
+        return grid.offset(x, y);
+    };
+    move.src = offset(sx, sy);
+    move.dst = offset(dx, dy);
+    return true;
+}
+
+template<typename Capacity>
+bool
+parse_solution_header(std::string const& line, basic_grid_t<Capacity> const& grid,
+                      solution_header_t & header) {
+    unsigned long long n;
+    int end = 0;
+    if ((sscanf(line.c_str(), "solution: %llu steps%n", &n, &end) != 1) || (end == 0)) {
+        return false;
+    }
+    header.steps = n;
+    header.has_ends = false;
+    char const * rest = line.c_str() + end;
+    if (std::strncmp(rest, " from ", 6) != 0) {
+        return true;
+    }
+    rest += 6;
+    size_t len = parse_server(rest, grid, header.data_start);
+    if ((len == 0) || (std::strncmp(rest + len, " to ", 4) != 0)) {
+        return true;
+    }
+    rest += len + 4;
+    header.has_ends = (parse_server(rest, grid, header.goal) != 0);
+    return true;
+}
+
+template<typename Capacity>
+basic_replay_t<Capacity>::basic_replay_t(basic_grid_t<Capacity> const& grid,
+                                         size_t data_start, size_t goal)
+    : grid_(grid), usage_(grid.usages(), grid.usages() + grid.size()),
+      data_(data_start), goal_(goal), moves_(0) {}
+
+template<typename Capacity>
+void
+basic_replay_t<Capacity>::apply(move_t const& m) {
+    auto fail = [this, &m](std::string const& why) {
+        return invalid_move("move " + std::to_string(moves_ + 1) + " (" +
+                            server_name(grid_, m.src) + " -> " + server_name(grid_, m.dst) +
+                            "): " + why);
+    };
+    bool adjacent = false;
+    for (grid_neighbor dir = grid_neighbor::North; dir <= grid_neighbor::West; ++dir) {
+        adjacent = adjacent || (grid_.neighbor(m.dst, dir) == m.src);
+    }
+    if (!adjacent) {
+        throw fail("servers are not adjacent");
+    }
+    if (grid_.wall(m.src)) {
+        throw fail("source is a wall");
+    }
+    if (usage_[m.src] == 0) {
+        throw fail("source has no data");
+    }
+    if (usage_[m.src] > grid_.capacity(m.dst) - usage_[m.dst]) {
+        throw fail("not enough space at the destination");
+    }
+    if ((m.src == data_) && (usage_[m.src] + usage_[m.dst] > grid_.capacity(goal_))) {
+        throw fail("the target data would no longer fit in the goal");
+    }
+    usage_[m.dst] += usage_[m.src];
+    usage_[m.src] = 0;
+    if (m.src == data_) {
+        data_ = m.dst;
+    }
+    ++moves_;
+}
+
+template<typename Capacity>
+size_t
+basic_replay_t<Capacity>::data_offset() const {
+    return data_;
+}
+
+template<typename Capacity>
+size_t
+basic_replay_t<Capacity>::goal() const {
+    return goal_;
+}
+
+template<typename Capacity>
+bool
+basic_replay_t<Capacity>::at_goal() const {
+    return data_ == goal_;
+}
+
+template<typename Capacity>
+size_t
+basic_replay_t<Capacity>::moves() const {
+    return moves_;
+}
+
+template void write_moves(std::ostream &, basic_grid_t<std::int16_t> const&, size_t, size_t,
+                          std::vector<move_t> const&);
+template void write_moves(std::ostream &, basic_grid_t<std::int32_t> const&, size_t, size_t,
+                          std::vector<move_t> const&);
+template std::string server_name(basic_grid_t<std::int16_t> const&, size_t);
+template std::string server_name(basic_grid_t<std::int32_t> const&, size_t);
+template size_t parse_server(char const *, basic_grid_t<std::int16_t> const&, size_t &);
+template size_t parse_server(char const *, basic_grid_t<std::int32_t> const&, size_t &);
+template bool parse_move(std::string const&, basic_grid_t<std::int16_t> const&, move_t &);
+template bool parse_move(std::string const&, basic_grid_t<std::int32_t> const&, move_t &);
+template bool parse_solution_header(std::string const&, basic_grid_t<std::int16_t> const&,
+                                    solution_header_t &);
+template bool parse_solution_header(std::string const&, basic_grid_t<std::int32_t> const&,
+                                    solution_header_t &);
+template struct basic_replay_t<std::int16_t>;
+template struct basic_replay_t<std::int32_t>;
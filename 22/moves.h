@@ -0,0 +1,90 @@
+#ifndef MOVES_H
+#define MOVES_H
+
+// Solutions as move lists, and replaying them against the initial usages
+// A solution is written as a step count and where the target data goes, followed by
+// one move per line:
+//   solution: 215 steps from node-x37-y0 to node-x0-y0:
+//   node-x35-y23 -> node-x34-y23
+//   ...
+// Replaying needs only the grid and the current usages, so checking a solution takes
+// O(N + moves) time and memory however long it is.
+
+#include <iosfwd>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "grid.h"
+
+// one step of a solution: all of src's data goes to its neighbor dst
+struct move_t {
+    size_t src;
+    size_t dst;
+};
+
+// a move that breaks the rules, or a line that names servers not in the grid
+struct invalid_move : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+// "data_start" and "goal" are where the target data begins and ends up
+template<typename Capacity>
+void write_moves(std::ostream & os, basic_grid_t<Capacity> const& grid,
+                 size_t data_start, size_t goal, std::vector<move_t> const& moves);
+
+// "node-xA-yB", as servers are named in df output and in move lists
+template<typename Capacity>
+std::string server_name(basic_grid_t<Capacity> const& grid, size_t offset);
+
+// Recognize a server name at the start of "text", returning its length, or 0 if
+// there is none; throws invalid_move if the server is outside the grid
+template<typename Capacity>
+size_t parse_server(char const * text, basic_grid_t<Capacity> const& grid, size_t & offset);
+
+// Recognize "node-xA-yB -> node-xC-yD". Returns false for any other line; throws
+// invalid_move if either server is outside the grid.
+template<typename Capacity>
+bool parse_move(std::string const& line, basic_grid_t<Capacity> const& grid, move_t & move);
+
+// what the first line of a solution claims
+struct solution_header_t {
+    size_t steps;
+    bool   has_ends;      // whether it names the servers below
+    size_t data_start;
+    size_t goal;
+};
+
+// Recognize "solution: N steps ...", returning false for any other line. The servers
+// are taken from "from node-xA-yB to node-xC-yD" after the count, if it is there;
+// throws invalid_move if either is outside the grid.
+template<typename Capacity>
+bool parse_solution_header(std::string const& line, basic_grid_t<Capacity> const& grid,
+                           solution_header_t & header);
+
+template<typename Capacity>
+struct basic_replay_t {
+    // the target data starts on "data_start" and has to reach "goal"
+    basic_replay_t(basic_grid_t<Capacity> const& grid, size_t data_start, size_t goal);
+
+    // Apply a move, enforcing the same rules as the search: adjacent servers, a
+    // nonempty source that is not a wall, enough space in the destination, and
+    // target data that will still fit in the goal. Throws invalid_move.
+    void apply(move_t const& move);
+
+    size_t data_offset() const;
+    size_t goal()        const;
+    bool   at_goal()     const;
+    size_t moves()       const;
+
+private:
+    basic_grid_t<Capacity> const &    grid_;
+    std::vector<Capacity>             usage_;
+    size_t                            data_;
+    size_t                            goal_;
+    size_t                            moves_;
+};
+
+using replay_t = basic_replay_t<std::int16_t>;
+
+#endif // MOVES_H
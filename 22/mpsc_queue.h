@@ -0,0 +1,63 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+// Unbounded lock-free queue for many producers and a single consumer
+// This is Dmitry Vyukov's intrusive MPSC design: producers swap themselves in as the
+// new head with one atomic exchange, and the consumer follows "next" links from the
+// tail. A push that has exchanged but not yet linked is briefly invisible, so pop()
+// can report empty while a push is in progress; callers must track outstanding work
+// separately if they need to know that nothing is on the way.
+
+#include <atomic>
+#include <utility>
+
+template<typename T>
+struct mpsc_queue_t {
+    mpsc_queue_t() : head_(new node_t), tail_(head_.load()) {}
+
+    mpsc_queue_t(mpsc_queue_t const&) = delete;
+    mpsc_queue_t& operator=(mpsc_queue_t const&) = delete;
+
+    ~mpsc_queue_t() {
+        while (tail_) {
+            node_t * next = tail_->next.load(std::memory_order_relaxed);
+            delete tail_;
+            tail_ = next;
+        }
+    }
+
+    // any thread
+    void push(T value) {
+        node_t * n = new node_t;
+        n->value = std::move(value);
+        node_t * prev = head_.exchange(n, std::memory_order_acq_rel);
+        prev->next.store(n, std::memory_order_release);
+    }
+
+    // consumer thread only
+    bool pop(T & value) {
+        node_t * next = tail_->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        // "next" becomes the new stub node, so its value is no longer needed
+        value = std::move(next->value);
+        delete tail_;
+        tail_ = next;
+        return true;
+    }
+
+private:
+    struct node_t {
+        std::atomic<node_t *> next{nullptr};
+        T                     value;
+    };
+
+    // padded onto separate cache lines so producers and the consumer do not collide
+    // (padding rather than alignas, which C++14 operator new does not honor)
+    std::atomic<node_t *> head_;     // most recently pushed
+    char                  padding_[64 - sizeof(std::atomic<node_t *>)];
+    node_t *              tail_;     // stub; the oldest value is in tail_->next
+};
+
+#endif // MPSC_QUEUE_H
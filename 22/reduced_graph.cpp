@@ -0,0 +1,342 @@
+// Implementation of the reduced (hole + data) move graph for Advent of Code, Day 22
+
+#include "reduced_graph.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "stats.h"
+
+reduced_state_t::reduced_state_t() : data_(0), hole_count_(0), holes_{} {}
+
+void
+reduced_state_t::canonicalize() {
+    // insertion sort; there are at most max_holes
+    for (size_t i = 1; i < hole_count_; ++i) {
+        for (size_t j = i; (j > 0) && (holes_[j - 1] > holes_[j]); --j) {
+            std::swap(holes_[j - 1], holes_[j]);
+        }
+    }
+}
+
+size_t
+reduced_state_t::data_offset() const {
+    return data_;
+}
+
+size_t
+reduced_state_t::hole_count() const {
+    return hole_count_;
+}
+
+size_t
+reduced_state_t::hole(size_t idx) const {
+    return holes_[idx];
+}
+
+bool
+reduced_state_t::operator==(reduced_state_t const& other) const {
+    return (data_ == other.data_) && (hole_count_ == other.hole_count_) &&
+        std::equal(holes_.begin(), holes_.begin() + hole_count_, other.holes_.begin());
+}
+
+bool
+reduced_state_t::operator!=(reduced_state_t const& other) const {
+    return !(*this == other);
+}
+
+std::uint64_t
+reduced_state_t::hash() const {
+    // FNV-1a over the positions is plenty for a handful of integers
+    std::uint64_t h = 0xcbf29ce484222325ull;
+    auto mix = [&h](std::uint32_t v) {
+        h ^= v;
+        h *= 0x100000001b3ull;
+    };
+    mix(data_);
+    for (size_t i = 0; i < hole_count_; ++i) {
+        mix(holes_[i]);
+    }
+    return h;
+}
+
+reduced_state_t
+reduced_state_t::state_if_move(size_t from, size_t hole_idx) const {
+    reduced_state_t moved = *this;
+    if (from == data_) {
+        moved.data_ = holes_[hole_idx];
+    }
+    moved.holes_[hole_idx] = static_cast<std::uint32_t>(from);
+    moved.canonicalize();
+    return moved;
+}
+
+std::ostream&
+operator<<(std::ostream & os, reduced_state_t const& s) {
+    os << "original data at " << s.data_offset() << "\n";
+    os << "empty servers: ";
+    for (size_t i = 0; i < s.hole_count(); ++i) {
+        os << s.hole(i) << ", ";
+    }
+    return os;
+}
+
+template<typename Capacity>
+basic_reduced_move_graph_t<Capacity>::basic_reduced_move_graph_t(full_graph_t const & g)
+    : g_(g) {
+    if (!g.abstraction_sound()) {
+        throw std::invalid_argument("reduced state space is not equivalent: " +
+                                    g.abstraction_problem());
+    }
+    if (g.holes().size() > reduced_state_t::max_holes) {
+        throw std::invalid_argument("too many empty servers for the reduced state space");
+    }
+}
+
+template<typename Capacity>
+reduced_state_t
+basic_reduced_move_graph_t<Capacity>::initial_state() const {
+    return vertex_t(g_.data_start(), g_.holes().begin(), g_.holes().end());
+}
+
+// the data location and then the holes, in order; every state has as many holes
+template<typename Capacity>
+size_t
+basic_reduced_move_graph_t<Capacity>::state_bytes() const {
+    return sizeof(std::uint32_t) * (1 + g_.holes().size());
+}
+
+template<typename Capacity>
+void
+basic_reduced_move_graph_t<Capacity>::encode(vertex_t const& v, unsigned char * out) const {
+    std::uint32_t words[1 + reduced_state_t::max_holes];
+    words[0] = static_cast<std::uint32_t>(v.data_offset());
+    for (size_t i = 0; i < v.hole_count(); ++i) {
+        words[1 + i] = static_cast<std::uint32_t>(v.hole(i));
+    }
+    std::memcpy(out, words, state_bytes());
+}
+
+template<typename Capacity>
+reduced_state_t
+basic_reduced_move_graph_t<Capacity>::decode(unsigned char const * in) const {
+    std::uint32_t words[1 + reduced_state_t::max_holes];
+    std::memcpy(words, in, state_bytes());
+    return vertex_t(words[0], words + 1, words + 1 + g_.holes().size());
+}
+
+template<typename Capacity>
+move_t
+basic_reduced_move_graph_t<Capacity>::move(vertex_t const& from, vertex_t const& to) const {
+    // a hole is filled from a neighbor, which becomes a hole in its place
+    auto missing = [](vertex_t const& a, vertex_t const& b) {
+        for (size_t i = 0; i < a.hole_count(); ++i) {
+            bool found = false;
+            for (size_t j = 0; j < b.hole_count(); ++j) {
+                found = found || (a.hole(i) == b.hole(j));
+            }
+            if (!found) {
+                return a.hole(i);
+            }
+        }
+        throw std::invalid_argument("states are not one move apart");
+    };
+    return move_t{missing(to, from), missing(from, to)};
+}
+
+template<typename Capacity>
+std::vector<reduced_state_t>
+basic_reduced_move_graph_t<Capacity>::goal_states(size_t limit) const {
+    // the holes may be on any non-wall servers other than the goal
+    std::vector<size_t> open_servers;
+    for (size_t i = 0; i < g_.grid().size(); ++i) {
+        if ((i != g_.goal()) && (g_.classification(i) != server_class::Wall)) {
+            open_servers.push_back(i);
+        }
+    }
+    size_t k = g_.holes().size();
+    size_t count = 1;
+    for (size_t i = 0; i < k; ++i) {
+        if (open_servers.size() < k) {
+            count = 0;
+            break;
+        }
+        // running binomial coefficient; each step stays an integer
+        count = count * (open_servers.size() - i) / (i + 1);
+        if (count > limit) {
+            throw std::length_error("too many goal states to search backward from");
+        }
+    }
+
+    std::vector<vertex_t> goals;
+    goals.reserve(count);
+    std::vector<size_t> choice(k);
+    std::vector<size_t> holes(k);
+    for (size_t i = 0; i < k; ++i) {
+        choice[i] = i;
+    }
+    while (count != 0) {
+        for (size_t i = 0; i < k; ++i) {
+            holes[i] = open_servers[choice[i]];
+        }
+        goals.emplace_back(g_.goal(), holes.begin(), holes.end());
+        // next combination in lexicographic order
+        size_t i = k;
+        while ((i > 0) && (choice[i - 1] == open_servers.size() - k + i - 1)) {
+            --i;
+        }
+        if (i == 0) {
+            break;
+        }
+        ++choice[i - 1];
+        for (size_t j = i; j < k; ++j) {
+            choice[j] = choice[j - 1] + 1;
+        }
+    }
+    return goals;
+}
+
+template<typename Capacity>
+typename basic_reduced_move_graph_t<Capacity>::full_graph_t const &
+basic_reduced_move_graph_t<Capacity>::full_graph() const {
+    return g_;
+}
+
+template<typename Capacity>
+size_t
+basic_reduced_move_graph_t<Capacity>::goal() const {
+    return g_.goal();
+}
+
+template<typename Capacity>
+typename basic_reduced_move_graph_t<Capacity>::full_graph_t::grid_type const &
+basic_reduced_move_graph_t<Capacity>::grid() const {
+    return g_.grid();
+}
+
+// IncidenceGraph free functions
+
+template<typename Capacity>
+reduced_state_t
+source(std::pair<reduced_state_t, reduced_state_t> const& e,
+       basic_reduced_move_graph_t<Capacity> const&) {
+    return e.first;
+}
+
+template<typename Capacity>
+reduced_state_t
+target(std::pair<reduced_state_t, reduced_state_t> const& e,
+       basic_reduced_move_graph_t<Capacity> const&) {
+    return e.second;
+}
+
+template<typename Capacity>
+std::pair<typename basic_reduced_move_graph_t<Capacity>::out_edge_iterator_t,
+          typename basic_reduced_move_graph_t<Capacity>::out_edge_iterator_t>
+out_edges(reduced_state_t const& u, basic_reduced_move_graph_t<Capacity> const& g) {
+    using iterator_t = typename basic_reduced_move_graph_t<Capacity>::out_edge_iterator_t;
+    return std::make_pair(iterator_t(&g, u), iterator_t());
+}
+
+template<typename Capacity>
+size_t
+out_degree(reduced_state_t const& u, basic_reduced_move_graph_t<Capacity> const& g) {
+    auto edges = out_edges(u, g);
+    return std::distance(edges.first, edges.second);
+}
+
+// Out edge iterator: each hole, in each direction, with a movable non-hole neighbor
+
+template<typename Capacity>
+basic_reduced_move_graph_t<Capacity>::out_edge_iterator_t::out_edge_iterator_t()
+    : graph_(nullptr), sentinel_(true), hole_idx_(0), dir_(grid_neighbor::Invalid) {}
+
+template<typename Capacity>
+basic_reduced_move_graph_t<Capacity>::out_edge_iterator_t::out_edge_iterator_t(
+    basic_reduced_move_graph_t const * g, vertex_t const & source)
+    : graph_(g), source_(source), sentinel_(false),
+      hole_idx_(0), dir_(grid_neighbor::North) {
+    ensure_valid();
+}
+
+template<typename Capacity>
+typename basic_reduced_move_graph_t<Capacity>::edge_t
+basic_reduced_move_graph_t<Capacity>::out_edge_iterator_t::dereference() const {
+    size_t from = graph_->g_.neighbor(source_.hole(hole_idx_), dir_);
+    return std::make_pair(source_, source_.state_if_move(from, hole_idx_));
+}
+
+template<typename Capacity>
+bool
+basic_reduced_move_graph_t<Capacity>::out_edge_iterator_t::equal(
+    out_edge_iterator_t const& other) const {
+    if (sentinel_ && other.sentinel_) {
+        return true;
+    }
+    return ((sentinel_ == other.sentinel_) &&
+            (source_   == other.source_) &&
+            (hole_idx_ == other.hole_idx_) &&
+            (dir_      == other.dir_));
+}
+
+template<typename Capacity>
+void
+basic_reduced_move_graph_t<Capacity>::out_edge_iterator_t::increment() {
+    if (!sentinel_) {
+        ++dir_;
+        ensure_valid();
+    }
+}
+
+template<typename Capacity>
+void
+basic_reduced_move_graph_t<Capacity>::out_edge_iterator_t::ensure_valid() {
+    if (sentinel_) {
+        return;
+    }
+
+    full_graph_t const & g = graph_->g_;
+    for (; hole_idx_ < source_.hole_count(); ++hole_idx_) {
+        for (; dir_ <= grid_neighbor::West; ++dir_) {
+            size_t from = g.neighbor(source_.hole(hole_idx_), dir_);
+            if (from == g.grid().size()) {
+                D22_COUNT(rejected_off_grid);
+                continue;
+            }
+            if (g.classification(from) == server_class::Wall) {
+                D22_COUNT(rejected_wall);
+                continue;
+            }
+            // data never moves out of a hole
+            bool from_hole = false;
+            for (size_t i = 0; i < source_.hole_count(); ++i) {
+                from_hole = from_hole || (source_.hole(i) == from);
+            }
+            if (!from_hole) {
+                D22_COUNT(edges_generated);
+                return;
+            }
+            D22_COUNT(rejected_empty_source);
+        }
+        dir_ = grid_neighbor::North;
+    }
+    sentinel_ = true;
+}
+
+template struct basic_reduced_move_graph_t<std::int16_t>;
+template struct basic_reduced_move_graph_t<std::int32_t>;
+
+#define D22_INSTANTIATE_REDUCED_GRAPH_FUNCTIONS(Capacity)                              \
+    template reduced_state_t source(std::pair<reduced_state_t, reduced_state_t> const&, \
+                                    basic_reduced_move_graph_t<Capacity> const&);      \
+    template reduced_state_t target(std::pair<reduced_state_t, reduced_state_t> const&, \
+                                    basic_reduced_move_graph_t<Capacity> const&);      \
+    template std::pair<basic_reduced_move_graph_t<Capacity>::out_edge_iterator_t,      \
+                       basic_reduced_move_graph_t<Capacity>::out_edge_iterator_t>      \
+    out_edges(reduced_state_t const&, basic_reduced_move_graph_t<Capacity> const&);    \
+    template size_t                                                                    \
+    out_degree(reduced_state_t const&, basic_reduced_move_graph_t<Capacity> const&);
+
+D22_INSTANTIATE_REDUCED_GRAPH_FUNCTIONS(std::int16_t)
+D22_INSTANTIATE_REDUCED_GRAPH_FUNCTIONS(std::int32_t)
@@ -0,0 +1,150 @@
+#ifndef REDUCED_GRAPH_H
+#define REDUCED_GRAPH_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "graph.h"
+
+// A reduced ("hole + data") model of the same problem
+// When basic_move_graph_t::abstraction_sound() holds, every legal move slides some movable
+// data into an adjacent hole, so a state is fully described by the hole positions and
+// the position of the target data. Every state of this graph corresponds to exactly one
+// state of the full graph, and the two have the same moves, so shortest paths agree.
+// States do not depend on the capacity type; the graph does, through the full graph.
+
+struct reduced_state_t {
+    // grids with more holes are searched over full states
+    static constexpr size_t max_holes = 8;
+
+    reduced_state_t();
+    template<typename HoleIt>
+    reduced_state_t(size_t data_offset, HoleIt hbegin, HoleIt hend) : reduced_state_t() {
+        data_ = static_cast<std::uint32_t>(data_offset);
+        for (; hbegin != hend; ++hbegin) {
+            holes_[hole_count_++] = static_cast<std::uint32_t>(*hbegin);
+        }
+        canonicalize();
+    }
+
+    size_t data_offset() const;
+    size_t hole_count()  const;
+    size_t hole(size_t idx) const;
+
+    bool operator==(reduced_state_t const& other) const;
+    bool operator!=(reduced_state_t const& other) const;
+    std::uint64_t hash() const;
+
+    // slide the data in "from" into the hole at index "hole_idx"
+    reduced_state_t state_if_move(size_t from, size_t hole_idx) const;
+
+    friend std::ostream& operator<<(std::ostream &, reduced_state_t const&);
+
+private:
+    void canonicalize();   // keep holes sorted so equal states compare equal
+
+    std::uint32_t                          data_;
+    std::uint32_t                          hole_count_;
+    std::array<std::uint32_t, max_holes>   holes_;
+};
+
+namespace std {
+
+template<>
+struct hash<reduced_state_t> {
+    size_t operator()(reduced_state_t const& s) const {
+        return s.hash();
+    }
+};
+
+}
+
+template<typename Capacity>
+struct basic_reduced_move_graph_t {
+    using full_graph_t = basic_move_graph_t<Capacity>;
+    using vertex_t     = reduced_state_t;
+    using edge_t       = std::pair<vertex_t, vertex_t>;
+
+    // requires g.abstraction_sound(); g must outlive this object
+    explicit basic_reduced_move_graph_t(full_graph_t const & g);
+
+    struct out_edge_iterator_t
+        : boost::iterator_facade<out_edge_iterator_t,
+                                 edge_t,
+                                 boost::forward_traversal_tag,
+                                 edge_t> {
+
+        out_edge_iterator_t();
+        out_edge_iterator_t(basic_reduced_move_graph_t const * g, vertex_t const & source);
+
+        edge_t dereference() const;
+        bool equal(out_edge_iterator_t const& other) const;
+        void increment();
+
+    private:
+        void ensure_valid();
+
+        basic_reduced_move_graph_t const * graph_;
+        vertex_t                     source_;
+        bool                         sentinel_;
+        size_t                       hole_idx_;
+        grid_neighbor                dir_;
+    };
+
+    vertex_t                      initial_state() const;
+    full_graph_t const &          full_graph()    const;
+    size_t                        goal()          const;   // the full graph's
+
+    // the move that takes one state to the next along a path
+    move_t                        move(vertex_t const& from, vertex_t const& to) const;
+
+    // fixed-size encodings of states, for searches that keep them on disk
+    size_t                        state_bytes() const;
+    void                          encode(vertex_t const& v, unsigned char * out) const;
+    vertex_t                      decode(unsigned char const * in) const;
+
+    // every state with the target data at the goal, for searching backward;
+    // throws std::length_error if there would be more than "limit" of them
+    std::vector<vertex_t>         goal_states(size_t limit) const;
+    typename full_graph_t::grid_type const & grid() const;
+
+private:
+    full_graph_t const & g_;
+};
+
+using reduced_move_graph_t = basic_reduced_move_graph_t<std::int16_t>;
+
+namespace boost {
+
+template<typename Capacity>
+struct graph_traits<basic_reduced_move_graph_t<Capacity>> {
+    using vertex_descriptor      = reduced_state_t;
+    using edge_descriptor        = std::pair<reduced_state_t, reduced_state_t>;
+    using directed_category      = directed_tag;
+    using edge_parallel_category = disallow_parallel_edge_tag;
+
+    using traversal_category = incidence_graph_tag;
+    using out_edge_iterator  = typename basic_reduced_move_graph_t<Capacity>::out_edge_iterator_t;
+    using degree_size_type   = size_t;
+};
+
+}
+
+template<typename Capacity>
+reduced_state_t source(std::pair<reduced_state_t, reduced_state_t> const&,
+                       basic_reduced_move_graph_t<Capacity> const&);
+template<typename Capacity>
+reduced_state_t target(std::pair<reduced_state_t, reduced_state_t> const&,
+                       basic_reduced_move_graph_t<Capacity> const&);
+
+template<typename Capacity>
+std::pair<typename basic_reduced_move_graph_t<Capacity>::out_edge_iterator_t,
+          typename basic_reduced_move_graph_t<Capacity>::out_edge_iterator_t>
+out_edges(reduced_state_t const&, basic_reduced_move_graph_t<Capacity> const&);
+
+template<typename Capacity>
+size_t
+out_degree(reduced_state_t const&, basic_reduced_move_graph_t<Capacity> const&);
+
+#endif // REDUCED_GRAPH_H
@@ -0,0 +1,405 @@
+// Incremental replanning for Advent of Code, Day 22
+
+#include "replanner.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "moves.h"
+#include "stats.h"
+
+namespace {
+
+// g and rhs of a state no path to the goal reaches (yet)
+constexpr size_t unreached = std::numeric_limits<size_t>::max() / 4;
+
+}
+
+template<typename Capacity>
+std::vector<server_change_t>
+parse_server_changes(std::string const& line, basic_grid_t<Capacity> const& grid) {
+    std::vector<server_change_t> changes;
+    std::istringstream words(line);
+    std::string word;
+    while (words >> word) {
+        size_t offset;
+        size_t end = parse_server(word.c_str(), grid, offset);
+        if (end == 0) {
+            throw std::invalid_argument("expected a server, not " + word);
+        }
+        char op = word[end];
+        long long value;
+        int value_end = 0;
+        if (((op != '=') && (op != '+') && (op != '-')) ||
+            (sscanf(word.c_str() + end + 1, "%lld%n", &value, &value_end) != 1)) {
+            throw std::invalid_argument("expected =U, =U/C, +N or -N after the server in " +
+                                        word);
+        }
+        auto it = std::find_if(changes.begin(), changes.end(),
+                               [offset](auto const& c) { return c.offset == offset; });
+        if (it == changes.end()) {
+            changes.push_back(server_change_t{offset, grid.usage(offset), grid.capacity(offset)});
+            it = changes.end() - 1;
+        }
+
+        constexpr long long limit = std::numeric_limits<server_t::capacity_t>::max();
+        size_t rest = end + 1 + value_end;
+        if ((op == '=') && (rest < word.size()) && (word[rest] == '/')) {
+            long long capacity;
+            int capacity_end = 0;
+            if ((sscanf(word.c_str() + rest + 1, "%lld%n", &capacity, &capacity_end) != 1) ||
+                (capacity < 0) || (capacity > limit)) {
+                throw std::invalid_argument("capacity out of range in " + word);
+            }
+            it->capacity = static_cast<server_t::capacity_t>(capacity);
+            rest += 1 + capacity_end;
+        }
+        if (rest != word.size()) {
+            throw std::invalid_argument("unexpected text after the server in " + word);
+        }
+        long long usage = (op == '=') ? value : (op == '+') ? (it->usage + value) :
+                                                              (it->usage - value);
+        if ((usage < 0) || (usage > limit)) {
+            throw std::invalid_argument("usage out of range in " + word);
+        }
+        it->usage = static_cast<server_t::capacity_t>(usage);
+    }
+    return changes;
+}
+
+template<typename Capacity>
+basic_replanner_t<Capacity>::basic_replanner_t(grid_type grid, size_t data_start, size_t goal,
+                                               size_t goal_limit)
+    : data_start_(data_start), goal_(goal), goal_limit_(goal_limit), restarted_(false) {
+    for (size_t i = 0; i < grid.size(); ++i) {
+        servers_.push_back(server_t{grid.x(i), grid.y(i), grid.capacity(i)});
+        usages_.push_back(grid.usage(i));
+    }
+    model_ = build(std::move(grid), nullptr);
+    restart();
+}
+
+template<typename Capacity>
+typename basic_replanner_t<Capacity>::model_t
+basic_replanner_t<Capacity>::build(grid_type grid, model_t const * previous) const {
+    model_t m;
+    m.graph.reset(new graph_t(std::move(grid), data_start_, goal_));
+    if (!m.graph->abstraction_sound()) {
+        throw std::invalid_argument(m.graph->abstraction_problem());
+    }
+    if (m.graph->holes().size() > reduced_state_t::max_holes) {
+        throw std::invalid_argument("too many empty servers for the reduced state space");
+    }
+    m.reduced.reset(new reduced_graph_t(*m.graph));
+
+    // The hole distances depend only on the walls. Goal states need seeding on a new
+    // state space, or where a wall has gone.
+    bool same_walls = (previous != nullptr);
+    bool walls_gone = false;
+    for (size_t i = 0; previous && (i < m.graph->grid().size()); ++i) {
+        bool wall = (m.graph->classification(i) == server_class::Wall);
+        bool was  = (previous->graph->classification(i) == server_class::Wall);
+        same_walls = same_walls && (wall == was);
+        walls_gone = walls_gone || (was && !wall);
+    }
+    if (same_walls) {
+        m.tables_graph = previous->tables_graph;
+        m.tables = previous->tables;
+    } else {
+        m.tables_graph = std::make_shared<graph_t const>(*m.graph);
+        m.tables = std::make_shared<tables_t const>(*m.tables_graph);
+    }
+    m.h.reset(new heuristic_t(*m.reduced, *m.tables));
+    if (!previous || walls_gone ||
+        (m.graph->holes().size() != previous->graph->holes().size())) {
+        m.goals = m.reduced->goal_states(goal_limit_);
+    }
+    return m;
+}
+
+template<typename Capacity>
+void
+basic_replanner_t<Capacity>::update(std::vector<server_change_t> const& changes) {
+    auto servers = servers_;
+    auto usages = usages_;
+    for (auto const& c : changes) {
+        if (c.offset >= servers.size()) {
+            throw std::invalid_argument("change to a server outside the grid");
+        }
+        servers[c.offset].capacity = c.capacity;
+        usages[c.offset] = c.usage;
+    }
+    model_t next = build(grid_type(servers, usages), &model_);
+    servers_.swap(servers);
+    usages_.swap(usages);
+
+    restarted_ = (next.graph->holes().size() != model_.graph->holes().size());
+    if (restarted_) {
+        model_ = std::move(next);
+        restart();
+        return;
+    }
+
+    // Servers becoming walls, or ceasing to be, change the moves of states with the
+    // data or a hole on them, or a hole next to them
+    size_t n = servers_.size();
+    std::vector<bool> data_on(n), hole_near(n);
+    bool walls_moved = false;
+    for (size_t i = 0; i < n; ++i) {
+        if ((next.graph->classification(i) == server_class::Wall) ==
+            (model_.graph->classification(i) == server_class::Wall)) {
+            continue;
+        }
+        walls_moved = true;
+        data_on[i] = hole_near[i] = true;
+        for (grid_neighbor dir = grid_neighbor::North; dir <= grid_neighbor::West; ++dir) {
+            size_t side = model_.graph->neighbor(i, dir);
+            if (side != n) {
+                hole_near[side] = true;
+            }
+        }
+    }
+    std::vector<reduced_state_t> affected;
+    for (auto const& r : records_) {
+        if (!walls_moved) {
+            break;
+        }
+        reduced_state_t const & s = r.first;
+        bool touched = data_on[s.data_offset()];
+        for (size_t i = 0; i < s.hole_count(); ++i) {
+            touched = touched || hole_near[s.hole(i)];
+        }
+        if (!touched) {
+            continue;
+        }
+        affected.push_back(s);
+        // neighbors that may be losing their move to s
+        if (valid(s)) {
+            auto edges = out_edges(s, *model_.reduced);
+            for (auto ei = edges.first; ei != edges.second; ++ei) {
+                affected.push_back(target(*ei, *model_.reduced));
+            }
+        }
+    }
+
+    model_ = std::move(next);
+    for (auto const& s : affected) {
+        update_vertex(s);
+        // and those that may be gaining one
+        if (valid(s)) {
+            auto edges = out_edges(s, *model_.reduced);
+            for (auto ei = edges.first; ei != edges.second; ++ei) {
+                update_vertex(target(*ei, *model_.reduced));
+            }
+        }
+    }
+    for (auto const& s : model_.goals) {
+        if (!records_.count(s)) {
+            update_vertex(s);
+        }
+    }
+    std::vector<reduced_state_t>().swap(model_.goals);
+    rekey();
+}
+
+template<typename Capacity>
+void
+basic_replanner_t<Capacity>::restart() {
+    records_.clear();
+    open_.clear();
+    for (auto const& s : model_.goals) {
+        update_vertex(s);
+    }
+    std::vector<reduced_state_t>().swap(model_.goals);
+}
+
+template<typename Capacity>
+bool
+basic_replanner_t<Capacity>::valid(reduced_state_t const& s) const {
+    graph_t const & g = *model_.graph;
+    bool ok = (g.classification(s.data_offset()) != server_class::Wall);
+    for (size_t i = 0; i < s.hole_count(); ++i) {
+        ok = ok && (g.classification(s.hole(i)) != server_class::Wall);
+    }
+    return ok;
+}
+
+template<typename Capacity>
+size_t
+basic_replanner_t<Capacity>::lookahead(reduced_state_t const& s) const {
+    if (!valid(s)) {
+        return unreached;
+    }
+    if (s.data_offset() == goal_) {
+        return 0;
+    }
+    size_t best = unreached;
+    auto edges = out_edges(s, *model_.reduced);
+    for (auto ei = edges.first; ei != edges.second; ++ei) {
+        auto it = records_.find(target(*ei, *model_.reduced));
+        if ((it != records_.end()) && (it->second.g != unreached)) {
+            best = std::min(best, it->second.g + 1);
+        }
+    }
+    return best;
+}
+
+template<typename Capacity>
+void
+basic_replanner_t<Capacity>::update_vertex(reduced_state_t const& s) {
+    size_t rhs = lookahead(s);
+    auto it = records_.find(s);
+    if (it == records_.end()) {
+        if (rhs == unreached) {
+            return;
+        }
+        it = records_.emplace(s, record_t{unreached, rhs, false, false, 0}).first;
+    }
+    record_t & rec = it->second;
+    rec.rhs = rhs;
+    if (rec.g != rec.rhs) {
+        push(*it);
+    } else {
+        rec.open = false;
+    }
+}
+
+template<typename Capacity>
+void
+basic_replanner_t<Capacity>::push(node_t & node) {
+    record_t & rec = node.second;
+    size_t distance = std::min(rec.g, rec.rhs);
+    rec.open = true;
+    rec.key = distance + static_cast<size_t>((*model_.h)(node.first));
+    open_.push_back(open_entry_t{rec.key, distance, &node});
+    std::push_heap(open_.begin(), open_.end(), open_order_t());
+}
+
+// recompute the keys of every open state, for a new start or heuristic
+template<typename Capacity>
+void
+basic_replanner_t<Capacity>::rekey() {
+    std::vector<open_entry_t> entries;
+    entries.swap(open_);
+    for (auto const& e : entries) {
+        record_t & rec = e.node->second;
+        if (rec.open && (rec.key == e.key) && (std::min(rec.g, rec.rhs) == e.distance)) {
+            push(*e.node);
+        }
+    }
+}
+
+template<typename Capacity>
+typename basic_replanner_t<Capacity>::result_t
+basic_replanner_t<Capacity>::plan() {
+    result_t result;
+    reduced_state_t const start = model_.reduced->initial_state();
+    size_t const start_h = static_cast<size_t>((*model_.h)(start));
+    auto current = [](open_entry_t const& e) {
+        record_t const & rec = e.node->second;
+        return rec.open && (rec.key == e.key) && (std::min(rec.g, rec.rhs) == e.distance);
+    };
+
+    for (;;) {
+        while (!open_.empty() && !current(open_.front())) {
+            std::pop_heap(open_.begin(), open_.end(), open_order_t());
+            open_.pop_back();
+        }
+        if (open_.empty()) {
+            break;
+        }
+        // done once the start is consistent and nothing open could improve on it
+        auto it = records_.find(start);
+        size_t start_g   = (it != records_.end()) ? it->second.g : unreached;
+        size_t start_rhs = (it != records_.end()) ? it->second.rhs : unreached;
+        size_t start_distance = std::min(start_g, start_rhs);
+        open_entry_t const & top = open_.front();
+        if ((start_g == start_rhs) &&
+            !open_order_t()(open_entry_t{start_distance + start_h, start_distance, nullptr},
+                            top)) {
+            break;
+        }
+
+        open_entry_t e = top;
+        std::pop_heap(open_.begin(), open_.end(), open_order_t());
+        open_.pop_back();
+        reduced_state_t const & s = e.node->first;
+        record_t & rec = e.node->second;
+        rec.open = false;
+        ++result.examined;
+        D22_COUNT(examined);
+        result.reexpanded += rec.expanded;
+        rec.expanded = true;
+
+        bool lowered = (rec.g > rec.rhs);
+        rec.g = lowered ? rec.rhs : unreached;
+        if (!lowered) {
+            update_vertex(s);
+        }
+        if (valid(s)) {
+            auto edges = out_edges(s, *model_.reduced);
+            for (auto ei = edges.first; ei != edges.second; ++ei) {
+                update_vertex(target(*ei, *model_.reduced));
+            }
+        }
+        D22_PEAK(open_peak, open_.size());
+        D22_PROGRESS(result.examined, open_.size(), e.key);
+    }
+
+    auto g_of = [this](reduced_state_t const& s) {
+        auto it = records_.find(s);
+        return (it != records_.end()) ? it->second.g : unreached;
+    };
+    if (g_of(start) == unreached) {
+        return result;
+    }
+
+    // each step goes to a neighbor one move closer to the goal
+    stats::phase_t phase("path");
+    result.path.push_back(start);
+    for (size_t g = g_of(start); g != 0; --g) {
+        auto edges = out_edges(result.path.back(), *model_.reduced);
+        auto next = std::find_if(edges.first, edges.second, [&](auto const& edge) {
+            return g_of(target(edge, *model_.reduced)) == g - 1;
+        });
+        if (next == edges.second) {
+            throw std::logic_error("replanner distances are inconsistent");
+        }
+        result.path.push_back(target(*next, *model_.reduced));
+    }
+    return result;
+}
+
+template<typename Capacity>
+bool
+basic_replanner_t<Capacity>::restarted() const {
+    return restarted_;
+}
+
+template<typename Capacity>
+typename basic_replanner_t<Capacity>::grid_type const &
+basic_replanner_t<Capacity>::grid() const {
+    return model_.graph->grid();
+}
+
+template<typename Capacity>
+typename basic_replanner_t<Capacity>::graph_t const &
+basic_replanner_t<Capacity>::graph() const {
+    return *model_.graph;
+}
+
+template<typename Capacity>
+typename basic_replanner_t<Capacity>::reduced_graph_t const &
+basic_replanner_t<Capacity>::reduced_graph() const {
+    return *model_.reduced;
+}
+
+template std::vector<server_change_t>
+parse_server_changes(std::string const&, basic_grid_t<std::int16_t> const&);
+template std::vector<server_change_t>
+parse_server_changes(std::string const&, basic_grid_t<std::int32_t> const&);
+template struct basic_replanner_t<std::int16_t>;
+template struct basic_replanner_t<std::int32_t>;
@@ -0,0 +1,131 @@
+#ifndef REPLANNER_H
+#define REPLANNER_H
+
+// Incremental replanning as server usages drift (Lifelong Planning A*)
+// The search runs backward, from every goal state toward the start, over the reduced
+// state space - as D* Lite does - so each state's g is its distance to the goal. That
+// depends only on where the walls are, not on where the holes start. Alongside g, each
+// state keeps rhs, the distance its neighbors' g values say it should have; the open
+// list holds the states where the two disagree.
+// A batch of changes that moves walls only adds or removes the moves into and out of
+// the states with data or holes on or next to the servers concerned. Those states and
+// their neighbors get rhs recomputed, and the next plan() expands only as far as the
+// disagreement spreads. Changes that only move the holes change the start, and so the
+// heuristic, but no g values. A change in the number of holes is a different state
+// space, and starts the search over.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+#include "grid.h"
+#include "heuristic.h"
+#include "reduced_graph.h"
+#include "search.h"
+
+// new usage and capacity for one server
+struct server_change_t {
+    size_t                offset;
+    server_t::capacity_t  usage;
+    server_t::capacity_t  capacity;
+};
+
+// Read a batch of changes from a line of words like the solver service's queries:
+// "node-xA-yB=U" sets a usage, "+N" or "-N" adjusts one, and "node-xA-yB=U/C" sets a
+// usage and a capacity. Later words build on earlier ones for the same server. Throws
+// std::invalid_argument for anything else.
+template<typename Capacity>
+std::vector<server_change_t> parse_server_changes(std::string const& line,
+                                                  basic_grid_t<Capacity> const& grid);
+
+template<typename Capacity>
+struct basic_replanner_t {
+    using grid_type       = basic_grid_t<Capacity>;
+    using graph_t         = basic_move_graph_t<Capacity>;
+    using reduced_graph_t = basic_reduced_move_graph_t<Capacity>;
+    using tables_t        = basic_distance_tables_t<Capacity>;
+    using heuristic_t     = basic_reverse_move_heuristic_t<Capacity>;
+    using result_t        = search_result_t<reduced_state_t>;
+
+    // Plan to bring the data on "data_start" to "goal". Throws std::invalid_argument if
+    // the grid does not meet the reduced state conditions, and std::length_error if
+    // there would be more than "goal_limit" goal states.
+    basic_replanner_t(grid_type grid, size_t data_start, size_t goal,
+                      size_t goal_limit = size_t(1) << 24);
+
+    basic_replanner_t(basic_replanner_t const&) = delete;
+    basic_replanner_t& operator=(basic_replanner_t const&) = delete;
+
+    // Bring the search up to date and return a shortest path for the current usages.
+    // "examined" counts the states expanded by this call, and "reexpanded" those of
+    // them that some earlier expansion had already settled.
+    result_t plan();
+
+    // Apply a batch of changes for the next plan() to repair. Throws as the
+    // constructor does, leaving the planner as it was.
+    void update(std::vector<server_change_t> const& changes);
+
+    bool                    restarted()     const;   // the last update discarded the search
+    grid_type const &       grid()          const;
+    graph_t const &         graph()         const;
+    reduced_graph_t const & reduced_graph() const;
+
+private:
+    struct record_t {
+        size_t  g;
+        size_t  rhs;
+        bool    open;
+        bool    expanded;       // ever
+        size_t  key;            // while open: min(g, rhs) + h
+    };
+    using node_t = std::pair<reduced_state_t const, record_t>;
+
+    // lowest key first, breaking ties toward the smaller min(g, rhs)
+    struct open_entry_t {
+        size_t   key;
+        size_t   distance;
+        node_t * node;
+    };
+    struct open_order_t {
+        bool operator()(open_entry_t const& a, open_entry_t const& b) const {
+            return (a.key > b.key) || ((a.key == b.key) && (a.distance > b.distance));
+        }
+    };
+
+    // everything that depends on the usages, built before any of it is replaced
+    struct model_t {
+        std::unique_ptr<graph_t>            graph;
+        std::unique_ptr<reduced_graph_t>    reduced;
+        std::shared_ptr<graph_t const>      tables_graph;   // the one "tables" refer to,
+        std::shared_ptr<tables_t const>     tables;         // shared while the walls stay
+        std::unique_ptr<heuristic_t>        h;
+        std::vector<reduced_state_t>        goals;          // only those still to seed
+    };
+    model_t     build(grid_type grid, model_t const * previous) const;
+
+    bool        valid(reduced_state_t const& s) const;   // no data or hole on a wall
+    size_t      lookahead(reduced_state_t const& s) const;   // the rhs s should have
+    void        update_vertex(reduced_state_t const& s);
+    void        push(node_t & node);
+    void        restart();
+    void        rekey();
+
+    size_t                              data_start_;
+    size_t                              goal_;
+    size_t                              goal_limit_;
+    std::vector<server_t>               servers_;       // positions and capacities
+    std::vector<server_t::capacity_t>   usages_;
+    model_t                             model_;
+    bool                                restarted_;
+
+    std::unordered_map<reduced_state_t, record_t>   records_;
+    std::vector<open_entry_t>                       open_;   // a heap, with stale entries
+};
+
+using replanner_t = basic_replanner_t<std::int16_t>;
+
+#endif // REPLANNER_H
@@ -0,0 +1,165 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+// A* search over our implicit graphs, via Boost.Graph's astar_search_no_init
+// Works with any graph modeling IncidenceGraph whose vertices are hashable and
+// provide data_offset(), and which supplies goal() for the goal test.
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include <boost/graph/astar_search.hpp>
+#include <boost/property_map/function_property_map.hpp>
+#include <boost/property_map/property_map.hpp>
+
+#include "arena.h"
+#include "stats.h"
+
+template<typename Vertex>
+struct goal_reached {
+    Vertex state;
+};
+
+// the target data has reached its destination
+template<typename Graph, typename Vertex>
+bool
+at_goal(Graph const& g, Vertex const& state) {
+    return state.data_offset() == g.goal();
+}
+
+// specialize an astar visitor to detect when we've reached our goal
+// "rank" looks up a vertex's f value, for progress reports
+template<typename Rank>
+struct goal_state_finder : public boost::default_astar_visitor {
+    goal_state_finder(size_t & examined, Rank rank)
+        : examined_(&examined), discovered_(0), rank_(rank) {}
+
+    template<typename Vertex, typename Graph>
+    void discover_vertex( Vertex const&, Graph const&) {
+        ++discovered_;
+    }
+
+    template<typename Vertex, typename Graph>
+    void examine_vertex( Vertex const& state, Graph const& g) {
+        ++*examined_;
+        D22_COUNT(examined);
+        D22_PEAK(open_peak, open_size());
+        D22_PROGRESS(*examined_, open_size(), rank_(state));
+        if (at_goal(g, state)) {
+            throw goal_reached<Vertex>{state};
+        }
+    }
+
+private:
+    // approximate: reopened vertices are examined again without being rediscovered
+    size_t open_size() const {
+        return (discovered_ > *examined_) ? (discovered_ - *examined_) : 0;
+    }
+
+    size_t * examined_;
+    size_t   discovered_;
+    Rank     rank_;
+};
+
+template<typename Rank>
+goal_state_finder<Rank>
+make_goal_state_finder(size_t & examined, Rank rank) {
+    return goal_state_finder<Rank>(examined, rank);
+}
+
+template<typename Vertex>
+struct search_result_t {
+    std::vector<Vertex> path;            // start to goal inclusive; empty if none found
+    size_t              examined = 0;    // vertices taken from the open set
+    std::vector<size_t> examined_per_thread;   // parallel searches only
+    size_t              iterations = 0;  // iterative deepening and anytime only
+    size_t              reexpanded = 0;  // of those examined, how many had been before
+    size_t              examined_backward = 0;   // bidirectional only; part of examined
+
+    bool found() const { return !path.empty(); }
+};
+
+// Run A* from "start", returning the states along a shortest path to the goal
+template<typename Graph, typename Heuristic>
+search_result_t<typename boost::graph_traits<Graph>::vertex_descriptor>
+astar_solve(Graph const& g,
+            typename boost::graph_traits<Graph>::vertex_descriptor const& start,
+            Heuristic h) {
+    using namespace boost;
+    using vertex_t = typename graph_traits<Graph>::vertex_descriptor;
+
+    // Everything the search tracks per vertex lives in a single record, so each
+    // vertex is hashed and looked up once rather than once per property map
+    struct vertex_record_t {
+        size_t                    distance = std::numeric_limits<size_t>::max();
+        boost::default_color_type color    = boost::white_color;
+        size_t                    rank     = 0;
+        size_t                    index;
+        vertex_t                  predecessor;
+    };
+    arena_unordered_map_t<vertex_t, vertex_record_t> vertex_records;
+    auto record_lookup =
+        [&vertex_records](vertex_t const& v) -> vertex_record_t& {
+        auto it = vertex_records.find(v);
+        if (it == vertex_records.end()) {
+            // first visit. Index vertices in order of discovery - the mutable queue
+            // uses these to locate vertices within its heap
+            vertex_record_t rec;
+            rec.index = vertex_records.size();
+            rec.predecessor = v;
+            it = vertex_records.emplace(v, rec).first;
+        }
+        return it->second;
+    };
+
+    // field accessors for the named parameters
+    auto distance_lookup =
+        [&record_lookup](vertex_t const& v) -> size_t& { return record_lookup(v).distance; };
+    auto color_lookup =
+        [&record_lookup](vertex_t const& v) -> default_color_type& {
+        return record_lookup(v).color;
+    };
+    auto rank_lookup =
+        [&record_lookup](vertex_t const& v) -> size_t& { return record_lookup(v).rank; };
+    auto index_lookup =
+        [&record_lookup](vertex_t const& v) -> size_t& { return record_lookup(v).index; };
+    auto predecessor_lookup =
+        [&record_lookup](vertex_t const& v) -> vertex_t& { return record_lookup(v).predecessor; };
+
+    // set up initial state
+    distance_lookup(start) = 0;
+
+    search_result_t<vertex_t> result;
+
+    try {
+        // no_init is the appropriate variant for implicit graphs like ours
+        astar_search_no_init(
+            g,
+            start,
+            h,
+            // named params
+            weight_map(make_static_property_map<typename graph_traits<Graph>::edge_descriptor,
+                                                size_t>(1)).
+            vertex_index_map(make_function_property_map<vertex_t, size_t&>(index_lookup)).
+            rank_map(make_function_property_map<vertex_t, size_t&>(rank_lookup)).
+            distance_map(make_function_property_map<vertex_t, size_t&>(distance_lookup)).
+            color_map(make_function_property_map<vertex_t, default_color_type&>(color_lookup)).
+            visitor(make_goal_state_finder(result.examined, rank_lookup)).
+            predecessor_map(make_function_property_map<vertex_t, vertex_t&>(predecessor_lookup))
+            );
+    } catch (goal_reached<vertex_t> const& e) {
+        // reverse path for display
+        stats::phase_t phase("path");
+        std::vector<vertex_t> & soln_path = result.path;
+        auto next_state = e.state;
+        do {
+            soln_path.push_back(next_state);
+            next_state = predecessor_lookup(next_state);
+        } while (!(soln_path.back() == next_state));
+        std::reverse(soln_path.begin(), soln_path.end());
+    }
+    return result;
+}
+
+#endif // SEARCH_H
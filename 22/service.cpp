@@ -0,0 +1,398 @@
+// Solver service for Advent of Code, Day 22
+
+#include "service.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "moves.h"
+
+namespace {
+
+// the server named at the start of a word, leaving "end" just past the name
+template<typename Capacity>
+size_t
+word_server(std::string const& word, basic_grid_t<Capacity> const& grid, size_t & end) {
+    size_t offset;
+    end = parse_server(word.c_str(), grid, offset);
+    if (end == 0) {
+        throw std::invalid_argument("expected a server, not " + word);
+    }
+    return offset;
+}
+
+bool
+write_all(int fd, std::string const& text) {
+    size_t done = 0;
+    while (done < text.size()) {
+        ssize_t n = write(fd, text.data() + done, text.size() - done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+}
+
+template<typename Capacity>
+basic_solver_service_t<Capacity>::basic_solver_service_t(grid_type grid, size_t threads,
+                                                         size_t examined_limit,
+                                                         stored_distance_tables_t const * stored,
+                                                         std::shared_ptr<void const> storage)
+    : grid_(std::move(grid)), graph_(grid_), examined_limit_(examined_limit), stopping_(false) {
+    if (stored) {
+        tables_.reset(new tables_t(graph_, *stored, std::move(storage)));
+    } else {
+        tables_.reset(new tables_t(graph_));
+    }
+    for (size_t i = 0; i < grid_.size(); ++i) {
+        servers_.push_back(server_t{grid_.x(i), grid_.y(i), grid_.capacity(i)});
+    }
+    for (size_t t = 0; t < std::max<size_t>(threads, 1); ++t) {
+        threads_.emplace_back([this]() { work(); });
+    }
+}
+
+template<typename Capacity>
+basic_solver_service_t<Capacity>::~basic_solver_service_t() {
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex_);
+        stopping_ = true;
+    }
+    jobs_ready_.notify_all();
+    for (auto & t : threads_) {
+        t.join();
+    }
+}
+
+template<typename Capacity>
+std::future<std::string>
+basic_solver_service_t<Capacity>::submit(std::string query) {
+    job_t job{std::move(query), std::promise<std::string>()};
+    auto answer = job.answer.get_future();
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex_);
+        jobs_.push_back(std::move(job));
+    }
+    jobs_ready_.notify_one();
+    return answer;
+}
+
+// each worker thread: take queries until the service shuts down and none are left
+template<typename Capacity>
+void
+basic_solver_service_t<Capacity>::work() {
+    worker_t w;
+    for (;;) {
+        job_t job;
+        {
+            std::unique_lock<std::mutex> lock(jobs_mutex_);
+            jobs_ready_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+            if (jobs_.empty()) {
+                return;
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        job.answer.set_value(answer(job.query, w));
+    }
+}
+
+template<typename Capacity>
+std::string
+basic_solver_service_t<Capacity>::answer(std::string const& line, worker_t & w) {
+    // the last query's states are done with; reclaim them all at once
+    w.reduced.clear();
+    w.full.clear();
+    w.arena.reset();
+    arena_scope_t scope(&w.arena);
+    try {
+        return solve(parse(line), w);
+    } catch (std::exception const& e) {
+        return std::string("error: ") + e.what();
+    }
+}
+
+template<typename Capacity>
+typename basic_solver_service_t<Capacity>::query_t
+basic_solver_service_t<Capacity>::parse(std::string const& line) const {
+    query_t q{graph_.data_start(), graph_.goal(), {}, false};
+    std::istringstream words(line);
+    std::string word;
+    size_t end;
+    while (words >> word) {
+        if ((word == "from") || (word == "to")) {
+            std::string server;
+            if (!(words >> server)) {
+                throw std::invalid_argument("\"" + word + "\" needs a server");
+            }
+            size_t offset = word_server(server, grid_, end);
+            if (end != server.size()) {
+                throw std::invalid_argument("expected a server, not " + server);
+            }
+            ((word == "from") ? q.data_start : q.goal) = offset;
+            continue;
+        }
+        if (word == "moves") {
+            q.moves = true;
+            continue;
+        }
+
+        // a usage change, applied on top of any earlier change to the same server
+        size_t offset = word_server(word, grid_, end);
+        char op = word[end];
+        long long value;
+        int value_end = 0;
+        if (((op != '=') && (op != '+') && (op != '-')) ||
+            (sscanf(word.c_str() + end + 1, "%lld%n", &value, &value_end) != 1) ||
+            (end + 1 + value_end != word.size())) {
+            throw std::invalid_argument("expected =N, +N or -N after the server in " + word);
+        }
+        auto it = std::find_if(q.usages.begin(), q.usages.end(),
+                               [offset](auto const& u) { return u.first == offset; });
+        long long usage = (it != q.usages.end()) ? it->second : grid_.usage(offset);
+        usage = (op == '=') ? value : (op == '+') ? (usage + value) : (usage - value);
+        if ((usage < 0) || (usage > std::numeric_limits<server_t::capacity_t>::max())) {
+            throw std::invalid_argument("usage out of range in " + word);
+        }
+        if (it != q.usages.end()) {
+            it->second = static_cast<server_t::capacity_t>(usage);
+        } else {
+            q.usages.emplace_back(offset, static_cast<server_t::capacity_t>(usage));
+        }
+    }
+    return q;
+}
+
+// the tables for searches toward "goal" over the loaded walls, built on first use
+template<typename Capacity>
+typename basic_solver_service_t<Capacity>::tables_t const &
+basic_solver_service_t<Capacity>::tables_for(size_t goal) {
+    if (goal == graph_.goal()) {
+        return *tables_;
+    }
+    goal_tables_t * entry;
+    {
+        std::lock_guard<std::mutex> lock(tables_mutex_);
+        auto & slot = goal_tables_[goal];
+        if (!slot) {
+            slot.reset(new goal_tables_t);
+        }
+        entry = slot.get();
+    }
+    std::call_once(entry->built, [this, entry, goal]() {
+        entry->graph.reset(new graph_t(grid_, graph_.data_start(), goal));
+        entry->tables.reset(new tables_t(*entry->graph, *tables_));
+    });
+    return *entry->tables;
+}
+
+template<typename Capacity>
+std::string
+basic_solver_service_t<Capacity>::solve(query_t const& q, worker_t & w) {
+    // the loaded grid, or one with this query's usages
+    grid_type grid = grid_;
+    if (!q.usages.empty()) {
+        std::vector<server_t::capacity_t> usages(grid_.usages(), grid_.usages() + grid_.size());
+        for (auto const& u : q.usages) {
+            usages[u.first] = u.second;
+        }
+        grid = grid_type(servers_, usages);
+    }
+    graph_t g(grid, q.data_start, q.goal);
+    if ((q.data_start != q.goal) && (g.classification(q.data_start) != server_class::Movable)) {
+        if (g.classification(q.data_start) == server_class::Empty) {
+            throw std::invalid_argument(server_name(grid, q.data_start) + " holds no data");
+        }
+        return "no solution";
+    }
+
+    // the shared tables hold as long as the walls have not moved
+    bool same_walls = true;
+    for (size_t i = 0; (i < grid.size()) && same_walls; ++i) {
+        same_walls = ((g.classification(i) == server_class::Wall) ==
+                      (graph_.classification(i) == server_class::Wall));
+    }
+    std::unique_ptr<tables_t> own_tables;
+    if (!same_walls) {
+        own_tables.reset(new tables_t(g));
+    }
+    basic_server_move_heuristic_t<Capacity> h(g, own_tables ? *own_tables : tables_for(q.goal));
+
+    auto reply = [this, &q, &grid](auto const& graph, auto const& result) {
+        if (!result.found()) {
+            return (examined_limit_ && (result.examined == examined_limit_)) ?
+                "no solution found in " + std::to_string(examined_limit_) + " vertices" :
+                std::string("no solution");
+        }
+        std::string text = "solution: " + std::to_string(result.path.size() - 1) + " steps";
+        for (size_t i = 1; q.moves && (i < result.path.size()); ++i) {
+            move_t m = graph.move(result.path[i - 1], result.path[i]);
+            text += ((i == 1) ? ": " : ", ") + server_name(grid, m.src) + " -> " +
+                    server_name(grid, m.dst);
+        }
+        return text;
+    };
+    w.reduced.examined_limit = w.full.examined_limit = examined_limit_;
+    if (g.abstraction_sound() && (g.holes().size() <= reduced_state_t::max_holes)) {
+        basic_reduced_move_graph_t<Capacity> reduced(g);
+        return reply(reduced, bucket_solve(reduced, reduced.initial_state(), h, w.reduced));
+    }
+    return reply(g, bucket_solve(g, g.initial_state(), h, w.full));
+}
+
+template<typename Capacity>
+void
+basic_solver_service_t<Capacity>::serve(int in_fd, int out_fd) {
+    // Answers go out in query order, from a thread of their own so each is written as
+    // soon as it and everything before it is ready. The reader stays at most "window"
+    // queries ahead of the writer.
+    size_t const window = 4 * threads_.size();
+    std::mutex pending_mutex;
+    std::condition_variable pending_changed;
+    std::deque<std::future<std::string>> pending;
+    bool done = false;
+
+    std::thread writer([&]() {
+        bool connected = true;
+        for (;;) {
+            std::future<std::string> answer;
+            {
+                std::unique_lock<std::mutex> lock(pending_mutex);
+                pending_changed.wait(lock, [&]() { return done || !pending.empty(); });
+                if (pending.empty()) {
+                    return;
+                }
+                answer = std::move(pending.front());
+                pending.pop_front();
+            }
+            pending_changed.notify_all();
+            // keep collecting answers if the reader has gone away, so no query is lost
+            std::string line = answer.get() + "\n";
+            connected = connected && write_all(out_fd, line);
+        }
+    });
+
+    auto submit_line = [&](std::string line) {
+        if (!line.empty() && (line.back() == '\r')) {
+            line.pop_back();
+        }
+        if (line.find_first_not_of(" \t") == std::string::npos) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(pending_mutex);
+        pending_changed.wait(lock, [&]() { return pending.size() < window; });
+        pending.push_back(submit(std::move(line)));
+        lock.unlock();
+        pending_changed.notify_all();
+    };
+
+    int read_error = 0;
+    std::string partial;
+    char buffer[65536];
+    for (;;) {
+        ssize_t got = read(in_fd, buffer, sizeof(buffer));
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            read_error = errno;
+            break;
+        }
+        if (got == 0) {
+            break;
+        }
+        char const * begin = buffer;
+        char const * end = buffer + got;
+        for (char const * nl; (nl = std::find(begin, end, '\n')) != end; begin = nl + 1) {
+            partial.append(begin, nl);
+            submit_line(std::move(partial));
+            partial.clear();
+        }
+        partial.append(begin, end);
+    }
+    if (!partial.empty()) {
+        submit_line(std::move(partial));       // a last query without its newline
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        done = true;
+    }
+    pending_changed.notify_all();
+    writer.join();
+    if (read_error) {
+        throw std::system_error(read_error, std::generic_category(), "error reading queries");
+    }
+}
+
+template<typename Capacity>
+void
+basic_solver_service_t<Capacity>::listen(std::string const& path) {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw std::system_error(ENAMETOOLONG, std::generic_category(), path);
+    }
+    std::strcpy(addr.sun_path, path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "error creating socket");
+    }
+    // a socket left behind by an earlier run is replaced; anything else is not
+    struct stat st;
+    if ((stat(path.c_str(), &st) == 0) && S_ISSOCK(st.st_mode)) {
+        unlink(path.c_str());
+    }
+    if ((bind(fd, reinterpret_cast<sockaddr const *>(&addr), sizeof(addr)) != 0) ||
+        (::listen(fd, SOMAXCONN) != 0)) {
+        int err = errno;
+        close(fd);
+        throw std::system_error(err, std::generic_category(), "error listening on " + path);
+    }
+
+    // a client that disconnects early must not take the service down with it
+    signal(SIGPIPE, SIG_IGN);
+    for (;;) {
+        int conn = accept(fd, nullptr, nullptr);
+        if (conn < 0) {
+            if ((errno == EINTR) || (errno == ECONNABORTED)) {
+                continue;
+            }
+            int err = errno;
+            close(fd);
+            throw std::system_error(err, std::generic_category(), "error accepting on " + path);
+        }
+        std::thread([this, conn]() {
+            try {
+                serve(conn, conn);
+            } catch (std::system_error const& e) {
+                std::cerr << e.what() << "\n";
+            }
+            close(conn);
+        }).detach();
+    }
+}
+
+template struct basic_solver_service_t<std::int16_t>;
+template struct basic_solver_service_t<std::int32_t>;
@@ -0,0 +1,120 @@
+#ifndef SERVICE_H
+#define SERVICE_H
+
+// A long-running solver answering many queries against one loaded grid
+// Each query is a line of whitespace-separated words: changes to the loaded usages,
+// and where the target data starts and must go if not the puzzle's own corners.
+//   from node-x3-y0 to node-x0-y1 node-x1-y1=0 node-x2-y1+20 node-x2-y2-5 moves
+// "node-xA-yB=U" sets a usage and "+N" or "-N" adjusts one; "moves" asks for the moves
+// themselves and not just their number. Blank lines are ignored; every other line gets
+// exactly one line back, in the order the queries arrived:
+//   solution: 7 steps
+//   solution: 2 steps: node-x1-y0 -> node-x0-y0, node-x2-y0 -> node-x1-y0
+//   no solution
+//   no solution found in 1000000 vertices
+//   error: usage out of range for server x1-y1
+// The grid, its move graph and its distance tables are built once. Tables for other
+// goals share the goal-independent hole distances and are kept once built; a query
+// whose usages move the walls gets tables of its own. Queries are answered by a pool
+// of threads, each searching with the bucket engine and keeping its search memory,
+// arena included, from one query to the next.
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "arena.h"
+#include "bucket_search.h"
+#include "graph.h"
+#include "grid.h"
+#include "heuristic.h"
+#include "reduced_graph.h"
+
+template<typename Capacity>
+struct basic_solver_service_t {
+    using grid_type  = basic_grid_t<Capacity>;
+    using graph_t    = basic_move_graph_t<Capacity>;
+    using tables_t   = basic_distance_tables_t<Capacity>;
+
+    // Start "threads" workers for "grid", using distance tables already built for it
+    // (for example, from a snapshot) if "stored" is given; "storage" keeps those alive.
+    // Each search gives up after examining "examined_limit" vertices (0 for no limit).
+    basic_solver_service_t(grid_type grid, size_t threads, size_t examined_limit,
+                           stored_distance_tables_t const * stored = nullptr,
+                           std::shared_ptr<void const> storage = nullptr);
+    ~basic_solver_service_t();
+
+    basic_solver_service_t(basic_solver_service_t const&) = delete;
+    basic_solver_service_t& operator=(basic_solver_service_t const&) = delete;
+
+    // Answer the queries read from in_fd on out_fd until in_fd reaches end of file.
+    // Throws std::system_error if in_fd cannot be read.
+    void serve(int in_fd, int out_fd);
+
+    // Serve each connection to a Unix socket created at "path" as above. Only returns
+    // by throwing std::system_error, if the socket cannot be set up.
+    void listen(std::string const& path);
+
+    // the answer to a single query line; any thread may call this
+    std::future<std::string> submit(std::string query);
+
+private:
+    struct query_t {
+        size_t                                                  data_start;
+        size_t                                                  goal;
+        std::vector<std::pair<size_t, server_t::capacity_t>>    usages;   // changed ones
+        bool                                                    moves;
+    };
+
+    // the tables for one goal, and the graph they refer to
+    struct goal_tables_t {
+        std::once_flag              built;
+        std::unique_ptr<graph_t>    graph;
+        std::unique_ptr<tables_t>   tables;
+    };
+
+    // what each worker keeps between queries
+    struct worker_t {
+        search_arena_t                                      arena;
+        bucket_workspace_t<reduced_state_t>                 reduced;
+        bucket_workspace_t<basic_server_state_t<Capacity>>  full;
+    };
+
+    struct job_t {
+        std::string                 query;
+        std::promise<std::string>   answer;
+    };
+
+    query_t          parse(std::string const& line) const;   // throws std::invalid_argument
+    std::string      answer(std::string const& line, worker_t & w);
+    std::string      solve(query_t const& q, worker_t & w);
+    tables_t const & tables_for(size_t goal);
+    void             work();
+
+    grid_type const                 grid_;
+    graph_t const                   graph_;          // loaded usages, puzzle start and goal
+    size_t                          examined_limit_;
+    std::unique_ptr<tables_t>       tables_;
+    std::vector<server_t>           servers_;        // for building grids with other usages
+
+    std::mutex                                                      tables_mutex_;
+    std::unordered_map<size_t, std::unique_ptr<goal_tables_t>>      goal_tables_;
+
+    std::mutex                      jobs_mutex_;
+    std::condition_variable         jobs_ready_;
+    std::deque<job_t>               jobs_;
+    bool                            stopping_;
+    std::vector<std::thread>        threads_;
+};
+
+using solver_service_t = basic_solver_service_t<std::int16_t>;
+
+#endif // SERVICE_H
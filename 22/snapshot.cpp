@@ -0,0 +1,281 @@
+// Binary grid snapshots for Advent of Code, Day 22
+
+#include "snapshot.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "mapped_file.h"
+
+namespace {
+
+char const          magic[8] = {'d', '2', '2', 's', 'n', 'a', 'p', '\0'};
+constexpr std::uint32_t version = 2;
+constexpr std::uint64_t byte_order_mark = 0x0102030405060708ull;
+constexpr std::uint32_t has_tables_flag = 1;
+constexpr size_t        section_alignment = 64;
+
+struct header_t {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t flags;
+    std::uint64_t byte_order;
+    std::uint64_t file_size;
+    std::uint64_t checksum;          // of everything after the header
+    std::uint64_t width;
+    std::uint64_t height;
+    std::uint64_t grid_offset;
+    std::uint64_t grid_bytes;
+    // distance tables, if flagged; offsets are from the start of the file
+    std::uint64_t all_pairs;
+    std::uint64_t landmark_count;
+    std::uint64_t pair_dist_offset;
+    std::uint64_t landmarks_offset;
+    std::uint64_t landmark_dist_offset;
+    std::uint64_t goal_dist_offset;
+    std::uint64_t data_cost_offset;
+    std::uint64_t capacity_bits;     // width of the grid's capacity lanes
+};
+
+size_t
+round_up(size_t n, size_t m) {
+    return (n + m - 1) / m * m;
+}
+
+// FNV-1a, a word at a time; sections are whole numbers of words
+std::uint64_t
+checksum(char const * data, size_t bytes, std::uint64_t h = 0xcbf29ce484222325ull) {
+    for (size_t i = 0; i + 8 <= bytes; i += 8) {
+        std::uint64_t word;
+        memcpy(&word, data + i, 8);
+        h = (h ^ word) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+// a section to write: its data, and where its offset goes in the header
+struct section_t {
+    void const *    data;
+    size_t          bytes;
+    std::uint64_t * offset;
+};
+
+}
+
+template<typename Capacity>
+void
+write_snapshot(std::string const& filename, basic_grid_t<Capacity> const& grid,
+               basic_distance_tables_t<Capacity> const * tables) {
+    header_t header{};
+    memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.byte_order = byte_order_mark;
+    header.width = grid.width();
+    header.height = grid.height();
+    header.grid_bytes = grid.storage_bytes();
+    header.capacity_bits = 8 * sizeof(Capacity);
+
+    size_t n = grid.size();
+    std::vector<section_t> sections{{grid.storage(), grid.storage_bytes(), &header.grid_offset}};
+    if (tables) {
+        auto t = tables->stored();
+        header.flags |= has_tables_flag;
+        header.all_pairs = t.all_pairs;
+        header.landmark_count = t.landmark_count;
+        if (t.all_pairs) {
+            sections.push_back({t.pair_dist, n * n * sizeof(std::uint16_t),
+                                &header.pair_dist_offset});
+        } else {
+            sections.push_back({t.landmarks, t.landmark_count * sizeof(std::uint64_t),
+                                &header.landmarks_offset});
+            sections.push_back({t.landmark_dist, t.landmark_count * n * sizeof(std::uint32_t),
+                                &header.landmark_dist_offset});
+        }
+        sections.push_back({t.goal_dist, n * sizeof(std::uint32_t), &header.goal_dist_offset});
+        sections.push_back({t.data_cost, 4 * n * sizeof(std::uint32_t),
+                            &header.data_cost_offset});
+    }
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw snapshot_error("error opening " + filename + " for writing");
+    }
+    // the header goes last, once the offsets and checksum are known
+    size_t pos = round_up(sizeof(header_t), section_alignment);
+    out.seekp(pos);
+    std::vector<char> padding(section_alignment, 0);
+    header.checksum = 0xcbf29ce484222325ull;
+    for (auto & s : sections) {
+        *s.offset = pos;
+        size_t padded = round_up(s.bytes, section_alignment);
+        out.write(static_cast<char const *>(s.data), s.bytes);
+        out.write(padding.data(), padded - s.bytes);
+        // the padding may leave the last word partial; checksum it with the padding
+        std::vector<char> tail(padded - s.bytes / 8 * 8, 0);
+        memcpy(tail.data(), static_cast<char const *>(s.data) + s.bytes / 8 * 8, s.bytes % 8);
+        header.checksum = checksum(static_cast<char const *>(s.data), s.bytes / 8 * 8,
+                                   header.checksum);
+        header.checksum = checksum(tail.data(), tail.size(), header.checksum);
+        pos += padded;
+    }
+    header.file_size = pos;
+    out.seekp(0);
+    out.write(reinterpret_cast<char const *>(&header), sizeof(header));
+    if (!out) {
+        throw snapshot_error("error writing " + filename);
+    }
+}
+
+bool
+is_snapshot(char const * data, size_t size) {
+    return (size >= sizeof(magic)) && (memcmp(data, magic, sizeof(magic)) == 0);
+}
+
+namespace {
+
+// validate the header and everything it points to
+header_t const &
+checked_header(mapped_file_t const& file, std::string const& filename) {
+    auto fail = [&filename](std::string const& why) {
+        return snapshot_error(filename + ": " + why);
+    };
+    if (file.size() < sizeof(header_t)) {
+        throw fail("too short to be a snapshot");
+    }
+    header_t const & h = *reinterpret_cast<header_t const *>(file.data());
+    if (memcmp(h.magic, magic, sizeof(magic)) != 0) {
+        throw fail("not a snapshot");
+    }
+    if (h.version != version) {
+        throw fail("snapshot version " + std::to_string(h.version) + " (expected " +
+                   std::to_string(version) + ")");
+    }
+    if (h.byte_order != byte_order_mark) {
+        throw fail("snapshot written with a different byte order");
+    }
+    if (h.file_size != file.size()) {
+        throw fail("snapshot is truncated or has trailing data");
+    }
+
+    // every section must lie within the file
+    size_t n = h.width * h.height;
+    auto section = [&](std::uint64_t offset, std::uint64_t bytes) {
+        if ((offset % section_alignment) || (offset < sizeof(header_t)) ||
+            (offset > file.size()) || (bytes > file.size() - offset)) {
+            throw fail("bad section offset");
+        }
+    };
+    if ((h.width == 0) || (h.height == 0) || (n / h.width != h.height)) {
+        throw fail("bad grid dimensions");
+    }
+    if ((h.capacity_bits != 16) && (h.capacity_bits != 32)) {
+        throw fail("bad capacity width");
+    }
+    section(h.grid_offset, h.grid_bytes);
+    if (h.flags & has_tables_flag) {
+        if (h.all_pairs) {
+            if (n > 0xffffffffull) {
+                throw fail("bad distance tables");
+            }
+            section(h.pair_dist_offset, n * n * sizeof(std::uint16_t));
+        } else {
+            section(h.landmarks_offset, h.landmark_count * sizeof(std::uint64_t));
+            section(h.landmark_dist_offset, h.landmark_count * n * sizeof(std::uint32_t));
+        }
+        section(h.goal_dist_offset, n * sizeof(std::uint32_t));
+        section(h.data_cost_offset, 4 * n * sizeof(std::uint32_t));
+    }
+
+    size_t body = round_up(sizeof(header_t), section_alignment);
+    if (checksum(file.data() + body, file.size() - body) != h.checksum) {
+        throw fail("checksum mismatch");
+    }
+    return h;
+}
+
+template<typename Capacity>
+basic_grid_t<Capacity>
+mapped_grid(std::shared_ptr<mapped_file_t> const& file, std::string const& filename) {
+    header_t const & h = *reinterpret_cast<header_t const *>(file->data());
+    if (h.capacity_bits != 8 * sizeof(Capacity)) {
+        throw snapshot_error(filename + ": grid has " + std::to_string(h.capacity_bits) +
+                             "-bit capacities, not " + std::to_string(8 * sizeof(Capacity)));
+    }
+    try {
+        return basic_grid_t<Capacity>(
+            h.width, h.height, std::shared_ptr<void const>(file, file->data() + h.grid_offset),
+            h.grid_bytes);
+    } catch (std::invalid_argument const& e) {
+        throw snapshot_error(filename + ": " + e.what());
+    }
+}
+
+}
+
+snapshot_t::snapshot_t(std::string const& filename)
+    : snapshot_t(std::make_shared<mapped_file_t>(filename), filename) {}
+
+snapshot_t::snapshot_t(std::shared_ptr<mapped_file_t> file, std::string const& filename)
+    : file_(std::move(file)),
+      filename_(filename),
+      capacity_bits_(static_cast<unsigned>(checked_header(*file_, filename).capacity_bits)),
+      has_tables_(false),
+      tables_{} {
+    // make sure the grid section is laid out as its dimensions say
+    if (capacity_bits_ == 16) {
+        mapped_grid<std::int16_t>(file_, filename);
+    } else {
+        mapped_grid<std::int32_t>(file_, filename);
+    }
+    header_t const & h = *reinterpret_cast<header_t const *>(file_->data());
+    if (h.flags & has_tables_flag) {
+        has_tables_ = true;
+        char const * base = file_->data();
+        tables_.all_pairs = h.all_pairs;
+        tables_.landmark_count = h.landmark_count;
+        if (h.all_pairs) {
+            tables_.pair_dist = reinterpret_cast<std::uint16_t const *>(base + h.pair_dist_offset);
+        } else {
+            tables_.landmarks = reinterpret_cast<std::uint64_t const *>(base + h.landmarks_offset);
+            tables_.landmark_dist =
+                reinterpret_cast<std::uint32_t const *>(base + h.landmark_dist_offset);
+        }
+        tables_.goal_dist = reinterpret_cast<std::uint32_t const *>(base + h.goal_dist_offset);
+        tables_.data_cost = reinterpret_cast<std::uint32_t const *>(base + h.data_cost_offset);
+    }
+}
+
+unsigned
+snapshot_t::capacity_bits() const {
+    return capacity_bits_;
+}
+
+template<typename Capacity>
+basic_grid_t<Capacity>
+snapshot_t::grid() const {
+    return mapped_grid<Capacity>(file_, filename_);
+}
+
+bool
+snapshot_t::has_tables() const {
+    return has_tables_;
+}
+
+stored_distance_tables_t
+snapshot_t::tables() const {
+    return tables_;
+}
+
+std::shared_ptr<void const>
+snapshot_t::storage() const {
+    return file_;
+}
+
+template void write_snapshot(std::string const&, basic_grid_t<std::int16_t> const&,
+                             basic_distance_tables_t<std::int16_t> const *);
+template void write_snapshot(std::string const&, basic_grid_t<std::int32_t> const&,
+                             basic_distance_tables_t<std::int32_t> const *);
+template basic_grid_t<std::int16_t> snapshot_t::grid() const;
+template basic_grid_t<std::int32_t> snapshot_t::grid() const;
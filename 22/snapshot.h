@@ -0,0 +1,59 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+// Compact binary snapshots of a loaded grid, optionally with its distance tables
+// A snapshot is a fixed header followed by 64-byte aligned sections: the grid's lane
+// block exactly as grid_t lays it out, then each distance table array. Loading one
+// maps the file and points the grid and tables straight into the mapping, so startup
+// costs little more than the page faults. Values are in the writer's byte order; the
+// header records it, along with a format version, the width of the capacity lanes and
+// a checksum of everything after the header.
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "grid.h"
+#include "heuristic.h"
+
+struct mapped_file_t;
+
+// not a snapshot, a different version or byte order, truncated, or corrupt
+struct snapshot_error : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+// write "grid" and, if given, "tables" (which must have been built for that grid)
+template<typename Capacity>
+void write_snapshot(std::string const& filename, basic_grid_t<Capacity> const& grid,
+                    basic_distance_tables_t<Capacity> const * tables);
+
+// whether file contents start like a snapshot (as opposed to df output)
+bool is_snapshot(char const * data, size_t size);
+
+struct snapshot_t {
+    // map and validate a snapshot; throws snapshot_error or std::system_error
+    explicit snapshot_t(std::string const& filename);
+    // validate a snapshot already mapped; "filename" is for error messages
+    snapshot_t(std::shared_ptr<mapped_file_t> file, std::string const& filename);
+
+    // width of the grid's capacity lanes, 16 or 32 bits
+    unsigned capacity_bits() const;
+
+    // the grid, as stored; throws snapshot_error unless Capacity is capacity_bits() wide
+    template<typename Capacity>
+    basic_grid_t<Capacity> grid() const;
+
+    bool                         has_tables() const;
+    stored_distance_tables_t     tables()     const;   // if has_tables()
+    std::shared_ptr<void const>  storage()    const;   // keeps the mapping alive
+
+private:
+    std::shared_ptr<mapped_file_t>  file_;
+    std::string                     filename_;
+    unsigned                        capacity_bits_;
+    bool                            has_tables_;
+    stored_distance_tables_t        tables_;
+};
+
+#endif // SNAPSHOT_H
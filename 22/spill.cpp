@@ -0,0 +1,263 @@
+// Disk-resident search layers for Advent of Code, Day 22
+
+#include "spill.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <numeric>
+#include <queue>
+#include <system_error>
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace {
+
+std::system_error
+io_error(std::string const& what) {
+    return std::system_error(errno, std::generic_category(), what);
+}
+
+// buffered output to a new file
+struct record_writer_t {
+    explicit record_writer_t(std::string path) : path_(std::move(path)), bytes_(0) {
+        file_ = std::fopen(path_.c_str(), "wb");
+        if (!file_) {
+            throw io_error("error creating " + path_);
+        }
+        std::setvbuf(file_, nullptr, _IOFBF, 1 << 20);
+    }
+    ~record_writer_t() {
+        if (file_) {
+            std::fclose(file_);
+        }
+    }
+
+    void write(unsigned char const * p, size_t n) {
+        if (std::fwrite(p, 1, n, file_) != n) {
+            throw io_error("error writing " + path_);
+        }
+        bytes_ += n;
+    }
+
+    // returns the bytes written
+    size_t close() {
+        FILE * f = file_;
+        file_ = nullptr;
+        if (std::fclose(f) != 0) {
+            throw io_error("error writing " + path_);
+        }
+        return bytes_;
+    }
+
+private:
+    std::string path_;
+    FILE *      file_;
+    size_t      bytes_;
+};
+
+}
+
+spill_dir_t::spill_dir_t(std::string const& parent) {
+    std::vector<char> name(parent.begin(), parent.end());
+    std::string const pattern = "/d22-spill-XXXXXX";
+    name.insert(name.end(), pattern.begin(), pattern.end());
+    name.push_back('\0');
+    if (!mkdtemp(name.data())) {
+        throw io_error("error creating a directory in " + parent);
+    }
+    path_ = name.data();
+}
+
+spill_dir_t::~spill_dir_t() {
+    if (DIR * d = opendir(path_.c_str())) {
+        while (dirent * e = readdir(d)) {
+            if ((std::strcmp(e->d_name, ".") != 0) && (std::strcmp(e->d_name, "..") != 0)) {
+                unlink((path_ + "/" + e->d_name).c_str());
+            }
+        }
+        closedir(d);
+    }
+    rmdir(path_.c_str());
+}
+
+std::string const &
+spill_dir_t::path() const {
+    return path_;
+}
+
+std::uint64_t
+key_id(unsigned char const * key, size_t key_bytes) {
+    // FNV-1a, then the splitmix64 finalizer to spread short keys
+    std::uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < key_bytes; ++i) {
+        h ^= key[i];
+        h *= 0x100000001b3ull;
+    }
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+    return h ^ (h >> 31);
+}
+
+spill_layer_t::spill_layer_t(std::string path, size_t record_bytes)
+    : path_(std::move(path)), record_bytes_(record_bytes), file_(new mapped_file_t(path_)) {}
+
+size_t
+spill_layer_t::size() const {
+    return file_->size() / record_bytes_;
+}
+
+unsigned char const *
+spill_layer_t::record(size_t idx) const {
+    return reinterpret_cast<unsigned char const *>(file_->data()) + idx * record_bytes_;
+}
+
+std::uint64_t
+spill_layer_t::parent(size_t idx) const {
+    std::uint64_t id;
+    std::memcpy(&id, record(idx) + record_bytes_ - sizeof(id), sizeof(id));
+    return id;
+}
+
+spill_layer_builder_t::spill_layer_builder_t(spill_dir_t const& dir, size_t key_bytes,
+                                             size_t ram_bytes)
+    : dir_(dir.path()), key_bytes_(key_bytes),
+      record_bytes_(key_bytes + sizeof(std::uint64_t)),
+      capacity_(std::max<size_t>(1, ram_bytes / (record_bytes_ + sizeof(std::uint32_t)))),
+      count_(0), runs_written_(0), bytes_written_(0) {}
+
+spill_layer_builder_t::~spill_layer_builder_t() {
+    for (auto const& run : runs_) {
+        unlink(run.c_str());
+    }
+}
+
+unsigned char *
+spill_layer_builder_t::next_key() {
+    if (count_ == capacity_) {
+        spill();
+    }
+    // grow toward the budget only as needed
+    if (buffer_.size() < (count_ + 1) * record_bytes_) {
+        buffer_.resize(std::min(capacity_, std::max<size_t>(2 * count_, 1024)) * record_bytes_);
+    }
+    return buffer_.data() + count_ * record_bytes_;
+}
+
+void
+spill_layer_builder_t::add(std::uint64_t parent) {
+    std::memcpy(buffer_.data() + count_ * record_bytes_ + key_bytes_, &parent, sizeof(parent));
+    ++count_;
+}
+
+void
+spill_layer_builder_t::spill() {
+    if (count_ == 0) {
+        return;
+    }
+    auto key = [this](std::uint32_t i) { return buffer_.data() + i * record_bytes_; };
+    std::vector<std::uint32_t> order(count_);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+        return std::memcmp(key(a), key(b), key_bytes_) < 0;
+    });
+
+    std::string path = dir_ + "/run-" + std::to_string(runs_written_++);
+    record_writer_t out(path);
+    runs_.push_back(path);
+    unsigned char const * last = nullptr;
+    for (std::uint32_t i : order) {
+        if (!last || (std::memcmp(last, key(i), key_bytes_) != 0)) {
+            out.write(key(i), record_bytes_);
+            last = key(i);
+        }
+    }
+    bytes_written_ += out.close();
+    count_ = 0;
+}
+
+std::unique_ptr<spill_layer_t>
+spill_layer_builder_t::finish(std::string const& name,
+                              std::vector<std::unique_ptr<spill_layer_t>> const& earlier) {
+    spill();
+
+    std::vector<std::unique_ptr<mapped_file_t>> runs;
+    for (auto const& path : runs_) {
+        runs.emplace_back(new mapped_file_t(path));
+    }
+    std::vector<size_t> run_pos(runs.size(), 0);
+    auto run_key = [&](size_t r) {
+        return reinterpret_cast<unsigned char const *>(runs[r]->data()) + run_pos[r];
+    };
+
+    // the smallest key at the front, across all runs
+    auto later = [&](size_t a, size_t b) {
+        return std::memcmp(run_key(a), run_key(b), key_bytes_) > 0;
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heads(later);
+    for (size_t r = 0; r < runs.size(); ++r) {
+        if (runs[r]->size() != 0) {
+            heads.push(r);
+        }
+    }
+
+    // keys come out in order, so each earlier layer is scanned once alongside
+    std::vector<size_t> earlier_pos(earlier.size(), 0);
+    auto seen_before = [&](unsigned char const * key) {
+        for (size_t l = 0; l < earlier.size(); ++l) {
+            spill_layer_t const & layer = *earlier[l];
+            size_t & pos = earlier_pos[l];
+            int cmp = 1;
+            while ((pos < layer.size()) &&
+                   ((cmp = std::memcmp(layer.record(pos), key, key_bytes_)) < 0)) {
+                ++pos;
+            }
+            if ((pos < layer.size()) && (cmp == 0)) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    std::string path = dir_ + "/" + name;
+    {
+        record_writer_t out(path);
+        std::vector<unsigned char> last;
+        while (!heads.empty()) {
+            size_t r = heads.top();
+            heads.pop();
+            unsigned char const * rec = run_key(r);
+            if ((last.empty() || (std::memcmp(last.data(), rec, key_bytes_) != 0)) &&
+                !seen_before(rec)) {
+                out.write(rec, record_bytes_);
+            }
+            last.assign(rec, rec + key_bytes_);
+            run_pos[r] += record_bytes_;
+            if (run_pos[r] < runs[r]->size()) {
+                heads.push(r);
+            }
+        }
+        bytes_written_ += out.close();
+    }
+
+    runs.clear();
+    for (auto const& run : runs_) {
+        unlink(run.c_str());
+    }
+    runs_.clear();
+    return std::unique_ptr<spill_layer_t>(new spill_layer_t(path, record_bytes_));
+}
+
+size_t
+spill_layer_builder_t::runs_written() const {
+    return runs_written_;
+}
+
+size_t
+spill_layer_builder_t::bytes_written() const {
+    return bytes_written_;
+}
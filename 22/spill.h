@@ -0,0 +1,89 @@
+#ifndef SPILL_H
+#define SPILL_H
+
+// Disk-resident layers of states for external-memory search
+// A layer is a file of fixed-size records sorted by key: an encoded state followed by
+// an 8-byte id of the state it was reached from (key_id of its key). Candidates for
+// the next layer collect in a buffer of bounded size; each time it fills it is sorted,
+// stripped of duplicates and written out as a run. Finishing the layer merges the
+// runs, which are read through memory mappings, and drops any key already in an
+// earlier layer on the way - delayed duplicate detection.
+// I/O errors throw std::system_error.
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+// a fresh directory beneath "parent", removed along with its files on destruction
+struct spill_dir_t {
+    explicit spill_dir_t(std::string const& parent);
+    ~spill_dir_t();
+
+    spill_dir_t(spill_dir_t const&) = delete;
+    spill_dir_t& operator=(spill_dir_t const&) = delete;
+
+    std::string const & path() const;
+
+private:
+    std::string path_;
+};
+
+// id of a state, from its key; what each record stores about its predecessor
+std::uint64_t key_id(unsigned char const * key, size_t key_bytes);
+
+// one finished layer, mapped for reading
+struct spill_layer_t {
+    spill_layer_t(std::string path, size_t record_bytes);
+
+    size_t                size() const;                 // records
+    unsigned char const * record(size_t idx) const;
+    std::uint64_t         parent(size_t idx) const;     // key_id of the predecessor
+
+private:
+    std::string                     path_;
+    size_t                          record_bytes_;
+    std::unique_ptr<mapped_file_t>  file_;
+};
+
+// Collects the records of the next layer
+struct spill_layer_builder_t {
+    // at most "ram_bytes" of buffered records and their sort index
+    spill_layer_builder_t(spill_dir_t const& dir, size_t key_bytes, size_t ram_bytes);
+    ~spill_layer_builder_t();
+
+    spill_layer_builder_t(spill_layer_builder_t const&) = delete;
+    spill_layer_builder_t& operator=(spill_layer_builder_t const&) = delete;
+
+    // space for one more record's key; valid until the next call
+    unsigned char * next_key();
+    // keep the key last returned by next_key(), reached from "parent"
+    void            add(std::uint64_t parent);
+
+    // Merge everything added into a layer file named "name", leaving out keys found
+    // in any of "earlier", and start over empty
+    std::unique_ptr<spill_layer_t>
+    finish(std::string const& name,
+           std::vector<std::unique_ptr<spill_layer_t>> const& earlier);
+
+    size_t runs_written()  const;   // since construction
+    size_t bytes_written() const;   // runs and layers
+
+private:
+    void spill();                   // sort and write the buffer as a run
+
+    std::string                 dir_;
+    size_t                      key_bytes_;
+    size_t                      record_bytes_;
+    size_t                      capacity_;     // records the buffer holds
+    std::vector<unsigned char>  buffer_;
+    size_t                      count_;        // records in the buffer
+    std::vector<std::string>    runs_;         // unmerged
+    size_t                      runs_written_;
+    size_t                      bytes_written_;
+};
+
+#endif // SPILL_H
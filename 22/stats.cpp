@@ -0,0 +1,163 @@
+// Search instrumentation for Advent of Code, Day 22
+
+#include "stats.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace stats {
+
+namespace {
+
+char const * const counter_names[counter_count] = {
+    "examined",
+    "edges_generated",
+    "rejected_off_grid",
+    "rejected_wall",
+    "rejected_empty_source",
+    "rejected_no_room",
+    "rejected_origin_overflow",
+    "heuristic_calls",
+    "heuristic_ns",
+    "state_allocations",
+    "state_bytes",
+    "arena_allocations",
+    "heap_allocations",
+    "open_peak",
+};
+
+std::atomic<std::uint64_t> counters[counter_count];
+
+std::int64_t
+now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::int64_t const start_ns = now_ns();
+
+// phases in the order they first ran, with their total time
+std::mutex                                       phase_mutex;
+std::vector<std::pair<std::string, std::int64_t>> phases;
+
+thread_local unsigned heuristic_depth = 0;
+
+std::atomic<bool>         progress_enabled{false};
+std::atomic<std::int64_t> progress_interval_ns{0};
+std::atomic<std::int64_t> progress_next_ns{0};
+thread_local unsigned     progress_countdown = 1;
+
+}
+
+void
+add(counter_t c, std::uint64_t n) {
+    counters[c].fetch_add(n, std::memory_order_relaxed);
+}
+
+void
+record_peak(counter_t c, std::uint64_t v) {
+    std::uint64_t current = counters[c].load(std::memory_order_relaxed);
+    while ((v > current) &&
+           !counters[c].compare_exchange_weak(current, v, std::memory_order_relaxed)) {}
+}
+
+std::uint64_t
+value(counter_t c) {
+    return counters[c].load(std::memory_order_relaxed);
+}
+
+heuristic_timer_t::heuristic_timer_t() : start_ns_(0) {
+    if (heuristic_depth++ == 0) {
+        start_ns_ = now_ns();
+    }
+}
+
+heuristic_timer_t::~heuristic_timer_t() {
+    if (--heuristic_depth == 0) {
+        add(heuristic_calls, 1);
+        add(heuristic_ns, now_ns() - start_ns_);
+    }
+}
+
+phase_t::phase_t(char const * name) : name_(name), start_ns_(now_ns()) {}
+
+phase_t::~phase_t() {
+    std::int64_t elapsed = now_ns() - start_ns_;
+    std::lock_guard<std::mutex> lock(phase_mutex);
+    for (auto & p : phases) {
+        if (p.first == name_) {
+            p.second += elapsed;
+            return;
+        }
+    }
+    phases.emplace_back(name_, elapsed);
+}
+
+void
+enable_progress(double interval_seconds) {
+    progress_interval_ns = static_cast<std::int64_t>(interval_seconds * 1e9);
+    progress_next_ns = now_ns() + progress_interval_ns;
+    progress_enabled = true;
+}
+
+void
+progress(std::uint64_t examined, std::uint64_t open_size, std::uint64_t f) {
+    // only look at the clock every so often
+    if (!progress_enabled.load(std::memory_order_relaxed) || (--progress_countdown != 0)) {
+        return;
+    }
+    progress_countdown = 1024;
+    std::int64_t now = now_ns();
+    std::int64_t next = progress_next_ns.load(std::memory_order_relaxed);
+    if ((now < next) ||
+        !progress_next_ns.compare_exchange_strong(next, now + progress_interval_ns)) {
+        return;
+    }
+    char line[160];
+    snprintf(line, sizeof(line), "[%8.1fs] %llu examined, %llu open, f = %llu\n",
+             (now - start_ns) / 1e9, static_cast<unsigned long long>(examined),
+             static_cast<unsigned long long>(open_size), static_cast<unsigned long long>(f));
+    std::cerr << line;
+}
+
+void
+write_text(std::ostream & os) {
+    std::lock_guard<std::mutex> lock(phase_mutex);
+    for (auto const& p : phases) {
+        os << p.first << ": " << (p.second / 1e9) << "s\n";
+    }
+    if (!D22_STATS) {
+        os << "(search counters not compiled in; configure with -DD22_STATS=ON)\n";
+        return;
+    }
+    for (unsigned c = 0; c < counter_count; ++c) {
+        os << counter_names[c] << ": " << value(static_cast<counter_t>(c)) << "\n";
+    }
+}
+
+void
+write_json(std::ostream & os) {
+    std::lock_guard<std::mutex> lock(phase_mutex);
+    os << "{\n  \"phases_s\": {";
+    for (size_t i = 0; i < phases.size(); ++i) {
+        os << (i ? ", " : "") << "\"" << phases[i].first << "\": " << (phases[i].second / 1e9);
+    }
+    os << "},\n  \"counters_enabled\": " << (D22_STATS ? "true" : "false");
+    if (D22_STATS) {
+        os << ",\n  \"counters\": {";
+        for (unsigned c = 0; c < counter_count; ++c) {
+            os << (c ? ", " : "") << "\"" << counter_names[c] << "\": "
+               << value(static_cast<counter_t>(c));
+        }
+        os << "}";
+    }
+    os << "\n}\n";
+}
+
+}
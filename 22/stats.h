@@ -0,0 +1,89 @@
+#ifndef STATS_H
+#define STATS_H
+
+// Search instrumentation: counters on the hot paths, phase timers, and periodic
+// progress reports
+// The counters and progress reports cost an atomic add or a countdown wherever they
+// appear, so they are only compiled in when D22_STATS is nonzero; the D22_* macros
+// below expand to nothing otherwise. Phase timers are a few clock reads per run and
+// are always available.
+
+#include <cstdint>
+#include <iosfwd>
+
+#ifndef D22_STATS
+#define D22_STATS 0
+#endif
+
+namespace stats {
+
+enum counter_t : unsigned {
+    examined,                   // vertices expanded
+    edges_generated,            // moves produced by out edge iterators
+    rejected_off_grid,          // candidate moves from past the edge of the grid
+    rejected_wall,              // ... from a wall
+    rejected_empty_source,      // ... from a server with no data
+    rejected_no_room,           // ... into a server without enough space
+    rejected_origin_overflow,   // ... of the target data, too large for the goal
+    heuristic_calls,
+    heuristic_ns,
+    state_allocations,          // blocks allocated for state payloads, from arenas or not
+    state_bytes,                // and their total size
+    arena_allocations,          // blocks served by search arenas
+    heap_allocations,           // blocks search containers and arenas took from the heap
+    open_peak,                  // largest open set (or IDA* path) seen
+    counter_count
+};
+
+void          add(counter_t c, std::uint64_t n);
+void          record_peak(counter_t c, std::uint64_t value);
+std::uint64_t value(counter_t c);
+
+// Time heuristic evaluation; nested evaluations (one heuristic falling back on
+// another) are counted once
+struct heuristic_timer_t {
+    heuristic_timer_t();
+    ~heuristic_timer_t();
+
+private:
+    std::int64_t start_ns_;
+};
+
+// Accumulate wall time under a name for as long as this object lives
+struct phase_t {
+    explicit phase_t(char const * name);
+    ~phase_t();
+
+    phase_t(phase_t const&) = delete;
+    phase_t& operator=(phase_t const&) = delete;
+
+private:
+    char const * name_;
+    std::int64_t start_ns_;
+};
+
+// Report the search's state to standard error at most once per interval
+void enable_progress(double interval_seconds);
+void progress(std::uint64_t examined, std::uint64_t open_size, std::uint64_t f);
+
+// everything gathered so far
+void write_text(std::ostream & os);
+void write_json(std::ostream & os);
+
+}
+
+#if D22_STATS
+#define D22_COUNT(c)                   ::stats::add(::stats::c, 1)
+#define D22_COUNT_N(c, n)              ::stats::add(::stats::c, (n))
+#define D22_PEAK(c, v)                 ::stats::record_peak(::stats::c, (v))
+#define D22_TIME_HEURISTIC()           ::stats::heuristic_timer_t d22_heuristic_timer
+#define D22_PROGRESS(examined, open, f) ::stats::progress((examined), (open), (f))
+#else
+#define D22_COUNT(c)                   ((void)0)
+#define D22_COUNT_N(c, n)              ((void)0)
+#define D22_PEAK(c, v)                 ((void)0)
+#define D22_TIME_HEURISTIC()           ((void)0)
+#define D22_PROGRESS(examined, open, f) ((void)0)
+#endif
+
+#endif // STATS_H
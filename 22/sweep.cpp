@@ -0,0 +1,108 @@
+// One backward search giving the cost of every starting position, for Advent of Code, Day 22
+
+#include "sweep.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <unordered_set>
+
+#include "moves.h"
+#include "stats.h"
+
+template<typename Capacity>
+std::vector<std::uint32_t>
+relocation_costs(basic_reduced_move_graph_t<Capacity> const& g, size_t goal_limit) {
+    auto const & full = g.full_graph();
+    auto const & holes = full.holes();
+    size_t n = g.grid().size();
+    std::vector<std::uint32_t> costs(n, no_relocation);
+
+    size_t unlabeled = 0;
+    for (size_t i = 0; i < n; ++i) {
+        unlabeled += (full.classification(i) == server_class::Movable);
+    }
+    // record the cost of a starting state: one with the loaded holes
+    auto label = [&](reduced_state_t const& s, std::uint32_t moves) {
+        if (s == reduced_state_t(s.data_offset(), holes.begin(), holes.end())) {
+            costs[s.data_offset()] = moves;
+            --unlabeled;
+        }
+    };
+
+    // Every neighbor of a state is in the layer before it, its own layer or the one
+    // after, so those are all we need to remember to recognize states already seen
+    using layer_t = std::unordered_set<reduced_state_t>;
+    layer_t previous, current, next;
+    for (auto const& s : g.goal_states(goal_limit)) {
+        current.insert(s);
+        label(s, 0);
+    }
+    size_t examined = 0;
+    for (std::uint32_t moves = 1; !current.empty() && (unlabeled != 0); ++moves) {
+        for (auto const& s : current) {
+            ++examined;
+            D22_COUNT(examined);
+            auto edges = out_edges(s, g);
+            for (auto ei = edges.first; ei != edges.second; ++ei) {
+                reduced_state_t t = target(*ei, g);
+                if (previous.count(t) || current.count(t) || !next.insert(t).second) {
+                    continue;
+                }
+                label(t, moves);
+            }
+        }
+        D22_PEAK(open_peak, next.size());
+        D22_PROGRESS(examined, next.size(), moves);
+        previous.swap(current);
+        current.swap(next);
+        next.clear();
+    }
+    return costs;
+}
+
+template<typename Capacity>
+void
+write_relocation_costs(std::ostream & os, basic_move_graph_t<Capacity> const& g,
+                       std::vector<std::uint32_t> const& costs) {
+    auto const & grid = g.grid();
+    auto cell = [&](size_t i) -> std::string {
+        if (costs[i] != no_relocation) {
+            return std::to_string(costs[i]);
+        }
+        switch (g.classification(i)) {
+        case server_class::Wall:  return "#";
+        case server_class::Empty: return "_";
+        default:                  return "-";
+        }
+    };
+    size_t width = std::max<size_t>(3, std::to_string(grid.width() - 1).size());
+    for (size_t i = 0; i < grid.size(); ++i) {
+        width = std::max(width, cell(i).size());
+    }
+
+    os << "moves to bring each server's data to " << server_name(grid, g.goal())
+       << " (# wall, _ empty, - unreachable):\n";
+    os << std::setw(width) << "y\\x";
+    for (size_t x = 0; x < grid.width(); ++x) {
+        os << " " << std::setw(width) << x;
+    }
+    os << "\n";
+    for (size_t y = 0; y < grid.height(); ++y) {
+        os << std::setw(width) << y;
+        for (size_t x = 0; x < grid.width(); ++x) {
+            os << " " << std::setw(width) << cell(grid.offset(x, y));
+        }
+        os << "\n";
+    }
+}
+
+template std::vector<std::uint32_t>
+relocation_costs(basic_reduced_move_graph_t<std::int16_t> const&, size_t);
+template std::vector<std::uint32_t>
+relocation_costs(basic_reduced_move_graph_t<std::int32_t> const&, size_t);
+template void write_relocation_costs(std::ostream &, basic_move_graph_t<std::int16_t> const&,
+                                     std::vector<std::uint32_t> const&);
+template void write_relocation_costs(std::ostream &, basic_move_graph_t<std::int32_t> const&,
+                                     std::vector<std::uint32_t> const&);
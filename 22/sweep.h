@@ -0,0 +1,31 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+// Fewest moves to the goal for every starting position of the target data at once
+// Reduced moves are reversible - data slid into a hole can slide straight back - so a
+// breadth-first search outward from every goal state reaches each state at its
+// distance from the goal. Of the states it labels, the ones with the loaded holes are
+// the starting states, one per server the target data could start on; the search
+// stops once it has labeled all of those it can reach.
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include "reduced_graph.h"
+
+constexpr std::uint32_t no_relocation = 0xffffffff;
+
+// Moves to bring each server's data to g.goal(), indexed by offset; no_relocation
+// for walls, holes and servers whose data cannot get there. Throws std::length_error
+// if there would be more than "goal_limit" goal states to start from.
+template<typename Capacity>
+std::vector<std::uint32_t> relocation_costs(basic_reduced_move_graph_t<Capacity> const& g,
+                                            size_t goal_limit);
+
+// the costs laid out like the grid, a row for each y
+template<typename Capacity>
+void write_relocation_costs(std::ostream & os, basic_move_graph_t<Capacity> const& g,
+                            std::vector<std::uint32_t> const& costs);
+
+#endif // SWEEP_H
@@ -0,0 +1,175 @@
+// Solution checker for Advent of Code, Day 22
+// Replays a move list, as printed by d22, against the puzzle input it was solved from
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include <boost/program_options.hpp>
+
+#include "loader.h"
+#include "mapped_file.h"
+#include "moves.h"
+#include "snapshot.h"
+
+int main(int argc, char **argv) {
+    using namespace std;
+
+    namespace po = boost::program_options;
+    po::options_description visible("usage: d22_verify [options] input.txt [moves.txt]\n"
+                                    "Lines other than the step count and moves are ignored, "
+                                    "so d22's output can be piped in as is.\noptions");
+    visible.add_options()
+        ("help,h", "show this message")
+        ("from", po::value<string>(), "server the target data starts on (default: as the "
+                                      "solution says, or the upper right corner)")
+        ("to", po::value<string>(), "server the target data must reach (default: as the "
+                                    "solution says, or node-x0-y0)");
+    po::options_description all;
+    all.add(visible).add_options()
+        ("input", po::value<string>()->required(), "df output or snapshot solved")
+        ("moves", po::value<string>(), "solution to check (default standard input)");
+    po::positional_options_description positional;
+    positional.add("input", 1).add("moves", 1);
+
+    po::variables_map opts;
+    try {
+        po::store(po::command_line_parser(argc, argv).
+                  options(all).positional(positional).run(), opts);
+        if (opts.count("help")) {
+            cout << visible;
+            return 0;
+        }
+        po::notify(opts);
+    } catch (po::error const& e) {
+        cerr << e.what() << "\n" << visible;
+        return 1;
+    }
+
+    string input_fn = opts["input"].as<string>();
+    unique_ptr<snapshot_t> snapshot;
+    df_listing_t listing;
+    unsigned bits;
+    try {
+        auto file = make_shared<mapped_file_t>(input_fn);
+        if (is_snapshot(file->data(), file->size())) {
+            snapshot.reset(new snapshot_t(file, input_fn));
+            bits = snapshot->capacity_bits();
+        } else {
+            listing = parse_df(file->data(), file->data() + file->size(), input_fn);
+            if (listing.servers.empty()) {
+                cerr << "no servers found in " << input_fn << "\n";
+                return 1;
+            }
+            bits = capacity_bits(listing.servers);
+        }
+    } catch (runtime_error const& e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+
+    // replay against the grid with whichever capacity lanes it needs
+    auto verify = [&](auto const& grid) {
+        using grid_type = typename std::decay<decltype(grid)>::type;
+        string moves_fn = opts.count("moves") ? opts["moves"].as<string>() : "-";
+        ifstream moves_file;
+        if (moves_fn != "-") {
+            moves_file.open(moves_fn);
+            if (!moves_file.is_open()) {
+                cerr << "error opening " << moves_fn << "\n";
+                return 1;
+            }
+        }
+        istream & in = (moves_fn == "-") ? cin : moves_file;
+
+        // where the target data goes: as given by --from and --to, else as the solution's
+        // header says, else from the upper right corner to the origin
+        size_t data_start = grid.offset(grid.width() - 1, 0);
+        size_t goal = 0;
+        bool   given[2] = {false, false};
+        for (char const * name : {"from", "to"}) {
+            if (!opts.count(name)) {
+                continue;
+            }
+            bool   is_from = (string(name) == "from");
+            string server = opts[name].as<string>();
+            if (parse_server(server.c_str(), grid, is_from ? data_start : goal) != server.size()) {
+                cerr << "--" << name << " needs a server such as node-x1-y0, not "
+                     << server << "\n";
+                return 1;
+            }
+            given[is_from ? 0 : 1] = true;
+        }
+
+        // one line at a time, so memory does not grow with the solution; the replay
+        // starts with the header, or the first move if there is none before it
+        using replay_type = basic_replay_t<typename grid_type::capacity_t>;
+        unique_ptr<replay_type> replay;
+        bool   counted = false;
+        size_t steps = 0;
+        size_t line_no = 0;
+        string line;
+        try {
+            while (getline(in, line)) {
+                ++line_no;
+                move_t m;
+                solution_header_t header;
+                if (parse_move(line, grid, m)) {
+                    if (!replay) {
+                        replay.reset(new replay_type(grid, data_start, goal));
+                    }
+                    replay->apply(m);
+                } else if (!counted && parse_solution_header(line, grid, header)) {
+                    counted = true;
+                    steps = header.steps;
+                    if (!replay && header.has_ends) {
+                        data_start = given[0] ? data_start : header.data_start;
+                        goal = given[1] ? goal : header.goal;
+                    }
+                }
+            }
+        } catch (invalid_move const& e) {
+            cerr << moves_fn << ":" << line_no << ": " << e.what() << "\n";
+            return 1;
+        }
+        if (!replay) {
+            replay.reset(new replay_type(grid, data_start, goal));
+        }
+
+        if (!counted) {
+            cerr << moves_fn << ": no step count found\n";
+            return 1;
+        }
+        if (replay->moves() != steps) {
+            cerr << moves_fn << ": " << replay->moves() << " moves, but the solution claims "
+                 << steps << " steps\n";
+            return 1;
+        }
+        if (!replay->at_goal()) {
+            cerr << moves_fn << ": the target data ends at "
+                 << server_name(grid, replay->data_offset()) << ", not "
+                 << server_name(grid, replay->goal()) << "\n";
+            return 1;
+        }
+        cout << "valid: " << steps << " moves bring the target data to "
+             << server_name(grid, replay->goal()) << "\n";
+        return 0;
+    };
+    try {
+        if (bits == 16) {
+            return verify(snapshot ? snapshot->grid<std::int16_t>()
+                                   : grid_t(listing.servers, listing.usages));
+        }
+        return verify(snapshot ? snapshot->grid<std::int32_t>()
+                               : wide_grid_t(listing.servers, listing.usages));
+    } catch (invalid_argument const& e) {
+        cerr << input_fn << ": " << e.what() << "\n";
+        return 1;
+    } catch (runtime_error const& e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+}
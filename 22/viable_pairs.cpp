@@ -0,0 +1,120 @@
+// Viable pair counting and enumeration for Advent of Code, Day 22
+
+#include "viable_pairs.h"
+
+#include <algorithm>
+
+template<typename Capacity>
+size_t
+count_viable_pairs(basic_grid_t<Capacity> const& grid) {
+    using namespace std;
+
+    auto usages = grid.usages();
+    auto avail = grid.avails();
+    vector<int> sorted_avail(avail, avail + grid.size());
+    sort(sorted_avail.begin(), sorted_avail.end());
+
+    size_t count = 0;
+    for (size_t i = 0; i < grid.size(); ++i) {
+        if (usages[i] == 0) {
+            continue;      // no data to move
+        }
+        // every server with at least this much room is a candidate...
+        count += distance(lower_bound(sorted_avail.begin(), sorted_avail.end(),
+                                      static_cast<int>(usages[i])),
+                          sorted_avail.end());
+        // ...except the server itself
+        if (avail[i] >= usages[i]) {
+            --count;
+        }
+    }
+    return count;
+}
+
+template<typename Capacity>
+basic_viable_pair_range_t<Capacity>::basic_viable_pair_range_t(
+    basic_grid_t<Capacity> const& grid)
+    : grid_(grid) {}
+
+template<typename Capacity>
+typename basic_viable_pair_range_t<Capacity>::iterator
+basic_viable_pair_range_t<Capacity>::begin() const {
+    return iterator(this);
+}
+
+template<typename Capacity>
+typename basic_viable_pair_range_t<Capacity>::iterator
+basic_viable_pair_range_t<Capacity>::end() const {
+    return iterator();
+}
+
+template<typename Capacity>
+basic_viable_pair_range_t<Capacity>::iterator::iterator() : range_(nullptr), a_(0), b_(0) {}
+
+template<typename Capacity>
+basic_viable_pair_range_t<Capacity>::iterator::iterator(
+    basic_viable_pair_range_t const * range)
+    : range_(range), a_(0), b_(0) {
+    ensure_valid();
+}
+
+template<typename Capacity>
+std::pair<size_t, size_t>
+basic_viable_pair_range_t<Capacity>::iterator::dereference() const {
+    return std::make_pair(a_, b_);
+}
+
+template<typename Capacity>
+bool
+basic_viable_pair_range_t<Capacity>::iterator::equal(iterator const& other) const {
+    if (!range_ || !other.range_) {
+        return range_ == other.range_;   // both at end, or not
+    }
+    return (a_ == other.a_) && (b_ == other.b_);
+}
+
+template<typename Capacity>
+void
+basic_viable_pair_range_t<Capacity>::iterator::increment() {
+    if (range_) {
+        ++b_;
+        ensure_valid();
+    }
+}
+
+// advance to the next viable pair, or become the end iterator
+template<typename Capacity>
+void
+basic_viable_pair_range_t<Capacity>::iterator::ensure_valid() {
+    basic_grid_t<Capacity> const & grid = range_->grid_;
+    auto usages = grid.usages();
+    auto avails = grid.avails();
+
+    for (; a_ < grid.size(); ++a_) {
+        if (usages[a_] != 0) {
+            // check the block of 64 destinations containing b_, and those after it
+            while (b_ < grid.size()) {
+                size_t block = b_ / 64 * 64;
+                std::uint64_t room;
+                at_least_mask(avails + block, std::min<size_t>(64, grid.size() - block),
+                              usages[a_], &room);
+                room &= ~std::uint64_t(0) << (b_ - block);        // not yet visited
+                if ((a_ >= block) && (a_ < block + 64)) {
+                    room &= ~(std::uint64_t(1) << (a_ - block));  // not ourselves
+                }
+                if (room) {
+                    b_ = block + __builtin_ctzll(room);
+                    return;      // room to move there, if there is a path
+                }
+                b_ = block + 64;
+            }
+        }
+        b_ = 0;
+    }
+    range_ = nullptr;
+}
+
+template size_t count_viable_pairs(basic_grid_t<std::int16_t> const&);
+template size_t count_viable_pairs(basic_grid_t<std::int32_t> const&);
+template struct basic_viable_pair_range_t<std::int16_t>;
+template struct basic_viable_pair_range_t<std::int32_t>;
@@ -0,0 +1,59 @@
+#ifndef VIABLE_PAIRS_H
+#define VIABLE_PAIRS_H
+
+// Part 1: counting "viable pairs" (A, B) of distinct servers where A holds data and
+// all of it would fit in the space available on B
+
+#include <utility>
+#include <vector>
+
+#include <boost/iterator/iterator_facade.hpp>
+
+#include "graph.h"
+
+// Count viable pairs in O(N log N) by sorting the available space once and
+// locating each usage within it by binary search
+template<typename Capacity>
+size_t count_viable_pairs(basic_grid_t<Capacity> const& grid);
+
+// Lazily enumerate the viable pairs themselves, in (A, B) order
+// This is inherently O(N^2) in the worst case; prefer count_viable_pairs if only
+// the number is needed. Candidate destinations are tested 64 at a time.
+template<typename Capacity>
+struct basic_viable_pair_range_t {
+    using capacity_t = Capacity;
+
+    explicit basic_viable_pair_range_t(basic_grid_t<Capacity> const& grid);
+
+    struct iterator
+        : boost::iterator_facade<iterator,
+                                 std::pair<size_t, size_t>,
+                                 boost::forward_traversal_tag,
+                                 std::pair<size_t, size_t>> {
+
+        // default constructor for "end of pairs"
+        iterator();
+        iterator(basic_viable_pair_range_t const * range);
+
+        std::pair<size_t, size_t> dereference() const;
+        bool equal(iterator const& other) const;
+        void increment();
+
+    private:
+        void ensure_valid();
+
+        basic_viable_pair_range_t const * range_;
+        size_t                      a_;
+        size_t                      b_;
+    };
+
+    iterator begin() const;
+    iterator end()   const;
+
+private:
+    basic_grid_t<Capacity>          grid_;      // shares the grid's storage
+};
+
+using viable_pair_range_t = basic_viable_pair_range_t<std::int16_t>;
+
+#endif // VIABLE_PAIRS_H
@@ -0,0 +1,137 @@
+// Work-stealing thread pool for Advent of Code, Day 22
+
+#include "work_pool.h"
+
+#include <algorithm>
+
+work_pool_t::work_pool_t(size_t threads)
+    : thread_count_(std::max<size_t>(threads, 1)), shares_(new share_t[thread_count_]),
+      task_(nullptr), generation_(0), running_(0), stopping_(false), steals_(0) {
+    for (size_t t = 1; t < thread_count_; ++t) {
+        workers_.emplace_back(&work_pool_t::work, this, t);
+    }
+}
+
+work_pool_t::~work_pool_t() {
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        stopping_ = true;
+    }
+    start_.notify_all();
+    for (auto & t : workers_) {
+        t.join();
+    }
+}
+
+void
+work_pool_t::run(size_t count, std::function<void(size_t)> const& task) {
+    if (thread_count_ == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+    for (size_t t = 0; t < thread_count_; ++t) {
+        std::lock_guard<std::mutex> lock(shares_[t].m);
+        shares_[t].next = count * t / thread_count_;
+        shares_[t].end = count * (t + 1) / thread_count_;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        task_ = &task;
+        running_ = workers_.size();
+        ++generation_;
+    }
+    start_.notify_all();
+    drain(0);
+    std::unique_lock<std::mutex> lock(m_);
+    done_.wait(lock, [this]() { return running_ == 0; });
+    task_ = nullptr;
+}
+
+size_t
+work_pool_t::threads() const {
+    return thread_count_;
+}
+
+size_t
+work_pool_t::steals() const {
+    return steals_;
+}
+
+bool
+work_pool_t::take(size_t self, size_t & idx) {
+    {
+        share_t & own = shares_[self];
+        std::lock_guard<std::mutex> lock(own.m);
+        if (own.next < own.end) {
+            idx = own.next++;
+            return true;
+        }
+    }
+    // steal from whoever has the most left
+    for (;;) {
+        size_t victim = self;
+        size_t most = 0;
+        for (size_t t = 0; t < thread_count_; ++t) {
+            std::lock_guard<std::mutex> lock(shares_[t].m);
+            if (shares_[t].end - shares_[t].next > most) {
+                most = shares_[t].end - shares_[t].next;
+                victim = t;
+            }
+        }
+        if (most == 0) {
+            return false;
+        }
+        size_t begin, end;
+        {
+            share_t & v = shares_[victim];
+            std::lock_guard<std::mutex> lock(v.m);
+            if (v.next == v.end) {
+                continue;              // emptied since we looked
+            }
+            begin = v.next + (v.end - v.next) / 2;
+            end = v.end;
+            v.end = begin;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            ++steals_;
+        }
+        share_t & own = shares_[self];
+        std::lock_guard<std::mutex> lock(own.m);
+        own.next = begin + 1;
+        own.end = end;
+        idx = begin;
+        return true;
+    }
+}
+
+void
+work_pool_t::drain(size_t self) {
+    size_t idx;
+    while (take(self, idx)) {
+        (*task_)(idx);
+    }
+}
+
+void
+work_pool_t::work(size_t self) {
+    size_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_);
+            start_.wait(lock, [&]() { return stopping_ || (generation_ != seen); });
+            if (stopping_) {
+                return;
+            }
+            seen = generation_;
+        }
+        drain(self);
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            --running_;
+        }
+        done_.notify_one();
+    }
+}
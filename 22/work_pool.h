@@ -0,0 +1,59 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+// A fixed pool of threads running batches of independent tasks with work stealing
+// run(count, task) calls task(i) once for each i below count, spread over the pool's
+// threads and the caller, and returns when all are done. Each participant starts with
+// an equal, contiguous share of the indices and takes them from the front; one that
+// runs out steals the back half of the largest share left, so uneven tasks (states
+// with many or few moves) still keep every thread busy to the end of the batch.
+// Which thread runs a task is left to chance, so tasks must write only their own
+// results. Tasks must not throw.
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct work_pool_t {
+    // "threads" counts the caller; with one, run() does everything itself
+    explicit work_pool_t(size_t threads);
+    ~work_pool_t();
+
+    work_pool_t(work_pool_t const&) = delete;
+    work_pool_t& operator=(work_pool_t const&) = delete;
+
+    void   run(size_t count, std::function<void(size_t)> const& task);
+    size_t threads() const;
+    size_t steals()  const;    // shares stolen, since construction
+
+private:
+    // indices [next, end) still to run; the owner takes from the front, thieves the back
+    struct share_t {
+        std::mutex m;
+        size_t     next = 0;
+        size_t     end  = 0;
+    };
+
+    bool take(size_t self, size_t & idx);
+    void drain(size_t self);
+    void work(size_t self);
+
+    size_t                              thread_count_;
+    std::unique_ptr<share_t[]>          shares_;
+    std::vector<std::thread>            workers_;
+
+    std::mutex                          m_;
+    std::condition_variable             start_;
+    std::condition_variable             done_;
+    std::function<void(size_t)> const * task_;
+    size_t                              generation_;   // batches started
+    size_t                              running_;      // workers still in this batch
+    bool                                stopping_;
+    size_t                              steals_;
+};
+
+#endif // WORK_POOL_H